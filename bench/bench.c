@@ -0,0 +1,537 @@
+/* Benchmarks the trie, with and without a Bloom filter or a cache, against a
+ hash table and a sorted array with `bsearch` on several distributions of
+ keys. Sizes are powers of ten from 10^3 to the first argument, (default
+ 10^6.) Outputs comma-separated values on `stdout`. The generator is seeded
+ the same every time, so runs are reproducible. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free qsort bsearch strtoul */
+#include <stdio.h>  /* printf sprintf perror */
+#include <string.h> /* strlen strcmp memcpy */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+#include <math.h>   /* exp log */
+#include "../test/orcish.h"
+#include "perf.h"
+
+#define TRIE_NAME bench
+#include "../src/trie.h"
+#define TRIE_NAME bloom
+#define TRIE_BLOOM
+#include "../src/trie.h"
+#define TRIE_NAME cache
+#define TRIE_CACHE 4096
+#define TRIE_METRICS
+#include "../src/trie.h"
+
+/* Xorshift; <https://www.jstatsoft.org/v08/i14/paper>. */
+static unsigned long rng_state;
+static unsigned long rng(void) {
+	rng_state ^= rng_state << 13 & 0xffffffffUL;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5 & 0xffffffffUL;
+	return rng_state &= 0xffffffffUL;
+}
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** Unique keys in a `pool`; `key` is in random order and `sorted` is in
+ order. `hot` indexes `key` with a Zipf distribution, (`s = 1`.) */
+struct keys { char *pool; const char **key, **sorted; size_t size, *hot; };
+
+/** A generator of the `i`th key in `z`. */
+typedef void (*generate_fn)(char (*z)[64], size_t i);
+
+static void random_short(char (*const z)[64], const size_t i) {
+	size_t len = 3 + rng() % 8, j;
+	(void)i;
+	for(j = 0; j < len; j++) (*z)[j] = (char)('a' + rng() % 26);
+	(*z)[j] = '\0';
+}
+
+static void url(char (*const z)[64], const size_t i) {
+	static const char *const hosts[] = { "www.example.com", "example.org",
+		"cdn.example.net", "api.example.com" }, *const paths[] = { "users",
+		"images", "blog/posts", "static/js", "tenant" };
+	(void)i;
+	sprintf(*z, "https://%s/%s/%lu", hosts[rng() % 4], paths[rng() % 5],
+		rng() % 1000000);
+}
+
+static void sequential(char (*const z)[64], const size_t i)
+	{ sprintf(*z, "%010lu", (unsigned long)i); }
+
+/* There is no dictionary here; orcish is word-like. */
+static void word(char (*const z)[64], const size_t i)
+	{ (void)i; orcish(*z, 16); }
+
+/* Longer than fits in a `skip`, so the branch under it is escaped. */
+static void long_prefix(char (*const z)[64], const size_t i) {
+	size_t j;
+	(void)i;
+	strcpy(*z, "com.example.service.storage.replicated.cluster.");
+	for(j = strlen(*z); j < 56; j++) (*z)[j] = (char)('a' + rng() % 26);
+	(*z)[j] = '\0';
+}
+
+static const struct { const char *name; generate_fn generate; }
+	distributions[] = { { "random", &random_short }, { "url", &url },
+	{ "sequential", &sequential }, { "word", &word },
+	{ "prefix", &long_prefix } };
+
+static int cmp_key(const void *a, const void *b)
+	{ return strcmp(*(const char *const *)a, *(const char *const *)b); }
+
+/** Fills `keys` with up to `size` unique keys from `generate`, shuffled.
+ @return Success. */
+static int keys_fill(struct keys *const keys, const generate_fn generate,
+	const size_t size) {
+	char z[64];
+	size_t i, j, pool_size = 0, pool_cap = 0, *offset;
+	keys->pool = 0, keys->key = keys->sorted = 0, keys->size = 0, keys->hot = 0;
+	if(!(offset = malloc(sizeof *offset * size))
+		|| !(keys->key = malloc(sizeof *keys->key * size))) goto catch;
+	for(i = 0; i < size; i++) {
+		size_t len;
+		generate(&z, i), len = strlen(z) + 1;
+		if(pool_size + len > pool_cap) {
+			char *pool;
+			pool_cap = pool_cap ? pool_cap * 2 : 4096;
+			if(!(pool = realloc(keys->pool, pool_cap))) goto catch;
+			keys->pool = pool;
+		}
+		memcpy(keys->pool + pool_size, z, len);
+		offset[i] = pool_size, pool_size += len; /* The pool moves. */
+	}
+	for(i = 0; i < size; i++) keys->key[i] = keys->pool + offset[i];
+	free(offset), offset = 0;
+	qsort(keys->key, size, sizeof *keys->key, &cmp_key);
+	for(i = j = 0; i < size; i++)
+		if(!j || strcmp(keys->key[j - 1], keys->key[i]))
+		keys->key[j++] = keys->key[i];
+	keys->size = j;
+	if(!(keys->sorted = malloc(sizeof *keys->sorted * keys->size))) goto catch;
+	memcpy(keys->sorted, keys->key, sizeof *keys->key * keys->size);
+	for(i = keys->size; i > 1; i--) {
+		const char *temp;
+		j = rng() % i;
+		temp = keys->key[i - 1], keys->key[i - 1] = keys->key[j],
+			keys->key[j] = temp;
+	}
+	/* The inverse of the continuous approximation to the harmonic numbers. */
+	if(!(keys->hot = malloc(sizeof *keys->hot * keys->size))) goto catch;
+	for(i = 0; i < keys->size; i++) {
+		j = (size_t)exp(log(keys->size + 1.0) * rng() / 4294967296.0) - 1;
+		keys->hot[i] = j < keys->size ? j : keys->size - 1;
+	}
+	return 1;
+catch:
+	free(offset), free(keys->pool), free(keys->key), free(keys->sorted);
+	keys->pool = 0, keys->key = keys->sorted = 0;
+	return 0;
+}
+
+static void keys_(struct keys *const keys) {
+	free(keys->pool), free(keys->key), free(keys->sorted), free(keys->hot);
+	keys->pool = 0, keys->key = keys->sorted = 0, keys->hot = 0;
+}
+
+/* The keys that are being run, for operations that take all of them. */
+static const struct keys *all;
+
+/* Open addressing with linear probing and FNV-1a. */
+struct hash { const char **table; size_t capacity, size; };
+static const char hash_deleted[] = "";
+
+static unsigned long fnv(const char *a) {
+	unsigned long h = 2166136261UL;
+	while(*a) h = (h ^ (unsigned char)*a++) * 16777619UL & 0xffffffffUL;
+	return h;
+}
+
+static const char **hash_bucket(struct hash *const h, const char *const key,
+	const int is_insert) {
+	size_t i = fnv(key) & h->capacity - 1;
+	const char **grave = 0;
+	for( ; h->table[i]; i = i + 1 & h->capacity - 1) {
+		if(h->table[i] == hash_deleted) { if(!grave) grave = h->table + i; }
+		else if(!strcmp(h->table[i], key)) return h->table + i;
+	}
+	return is_insert ? grave ? grave : h->table + i : 0;
+}
+
+/** A structure to compare. `box` is one of them, depending. */
+union box { struct bench_trie trie; struct bloom_trie bloom;
+	struct cache_trie cache; struct hash hash;
+	struct { const char **array; size_t size; } sorted; };
+
+typedef size_t (*op_fn)(union box *, const char *);
+
+static size_t trie_add(union box *const b, const char *const key)
+	{ return (size_t)bench_trie_add(&b->trie, key); }
+static size_t trie_get(union box *const b, const char *const key)
+	{ return !!bench_trie_get(&b->trie, key); }
+static char miss_buffer[66];
+/** Appends a character that no key has to `key`, so it's not there, but the
+ path to it is. */
+static const char *miss_of(const char *const key) {
+	const size_t len = strlen(key);
+	memcpy(miss_buffer, key, len), miss_buffer[len] = '#',
+		miss_buffer[len + 1] = '\0';
+	return miss_buffer;
+}
+static size_t trie_miss(union box *const b, const char *const key)
+	{ return !!bench_trie_get(&b->trie, miss_of(key)); }
+static size_t trie_put(union box *const b, const char *const key)
+	{ return (size_t)bench_trie_put(&b->trie, key, 0); }
+static size_t trie_remove(union box *const b, const char *const key)
+	{ return !!bench_trie_remove(&b->trie, key); }
+static char prefix_buffer[64];
+/** Cuts the last two characters of `key` to make a prefix. */
+static const char *prefix_of(const char *const key) {
+	size_t len = strlen(key);
+	len = len > 3 ? len - 2 : 1;
+	memcpy(prefix_buffer, key, len), prefix_buffer[len] = '\0';
+	return prefix_buffer;
+}
+static size_t trie_prefix(union box *const b, const char *const key) {
+	struct bench_trie_iterator it;
+	size_t n = 0;
+	bench_trie_prefix(&b->trie, prefix_of(key), &it);
+	while(bench_trie_next(&it)) n++;
+	return n;
+}
+static size_t trie_iterate(union box *const b, const char *const key) {
+	struct bench_trie_iterator it;
+	size_t n = 0;
+	(void)key;
+	bench_trie_prefix(&b->trie, "", &it);
+	while(bench_trie_next(&it)) n++;
+	return n;
+}
+static size_t trie_sorted(union box *const b, const char *const key) {
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < all->size; i++) n += trie_get(b, all->sorted[i]);
+	return n;
+}
+/** Calls <fn:bench_trie_get_sorted_batch> on all the keys in order. */
+static size_t trie_batch(union box *const b, const char *const key) {
+	static const char *got[65536];
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < all->size; i += sizeof got / sizeof *got) {
+		const size_t m = all->size - i < sizeof got / sizeof *got
+			? all->size - i : sizeof got / sizeof *got;
+		n += bench_trie_get_sorted_batch(&b->trie, all->sorted + i, m, got);
+	}
+	return n;
+}
+/** Builds a new trie from all the keys in order with a hint. */
+static size_t trie_append(union box *const b, const char *const key) {
+	struct bench_trie trie = TRIE_IDLE;
+	struct bench_trie_hint hint;
+	size_t i, n = 0;
+	(void)b, (void)key;
+	bench_trie_hint(&hint);
+	for(i = 0; i < all->size
+		&& bench_trie_hint_add(&trie, &hint, all->sorted[i]); i++) n++;
+	bench_trie_(&trie);
+	return n;
+}
+static size_t trie_bytes(union box *const b) {
+	struct trie_stats stats;
+	return bench_trie_stats(&b->trie, &stats) ? stats.bytes : 0;
+}
+static void trie_clear(union box *const b) { bench_trie_(&b->trie); }
+
+static size_t bloom_add(union box *const b, const char *const key)
+	{ return (size_t)bloom_trie_add(&b->bloom, key); }
+static size_t bloom_get(union box *const b, const char *const key)
+	{ return !!bloom_trie_get(&b->bloom, key); }
+static size_t bloom_miss(union box *const b, const char *const key)
+	{ return !!bloom_trie_get(&b->bloom, miss_of(key)); }
+static size_t bloom_put(union box *const b, const char *const key)
+	{ return (size_t)bloom_trie_put(&b->bloom, key, 0); }
+static size_t bloom_remove(union box *const b, const char *const key)
+	{ return !!bloom_trie_remove(&b->bloom, key); }
+static size_t bloom_bytes(union box *const b) {
+	struct trie_stats stats;
+	return bloom_trie_stats(&b->bloom, &stats) ? stats.bytes : 0;
+}
+static void bloom_clear(union box *const b) { bloom_trie_(&b->bloom); }
+
+static size_t cache_add(union box *const b, const char *const key)
+	{ return (size_t)cache_trie_add(&b->cache, key); }
+static size_t cache_get(union box *const b, const char *const key)
+	{ return !!cache_trie_get(&b->cache, key); }
+static size_t cache_remove(union box *const b, const char *const key)
+	{ return !!cache_trie_remove(&b->cache, key); }
+static size_t cache_bytes(union box *const b) {
+	struct trie_stats stats;
+	return cache_trie_stats(&b->cache, &stats) ? stats.bytes : 0;
+}
+/** The hit rate of everything since the last clear goes to `stderr`. */
+static void cache_clear(union box *const b) {
+	struct trie_metrics m;
+	cache_trie_metrics(&m);
+	fprintf(stderr, "trie+cache: %lu hits, %lu misses, %.1f%% hit rate.\n",
+		(unsigned long)m.cache_hits, (unsigned long)m.cache_misses,
+		m.cache_hits ? 100.0 * m.cache_hits / (m.cache_hits + m.cache_misses)
+		: 0.0);
+	cache_trie_(&b->cache);
+}
+
+static int hash_init(union box *const b, const struct keys *const keys) {
+	struct hash *const h = &b->hash;
+	h->capacity = 1, h->size = 0;
+	while(h->capacity < keys->size * 2) h->capacity <<= 1;
+	return !!(h->table = calloc(h->capacity, sizeof *h->table));
+}
+static size_t hash_add(union box *const b, const char *const key) {
+	const char **const bucket = hash_bucket(&b->hash, key, 1);
+	if(*bucket && *bucket != hash_deleted) return 0;
+	return *bucket = key, b->hash.size++, 1;
+}
+static size_t hash_get(union box *const b, const char *const key)
+	{ return !!hash_bucket(&b->hash, key, 0); }
+static size_t hash_miss(union box *const b, const char *const key)
+	{ return !!hash_bucket(&b->hash, miss_of(key), 0); }
+static size_t hash_put(union box *const b, const char *const key) {
+	const char **const bucket = hash_bucket(&b->hash, key, 1);
+	if(!*bucket || *bucket == hash_deleted) b->hash.size++;
+	return *bucket = key, 1;
+}
+static size_t hash_remove(union box *const b, const char *const key) {
+	const char **const bucket = hash_bucket(&b->hash, key, 0);
+	if(!bucket) return 0;
+	return *bucket = hash_deleted, b->hash.size--, 1;
+}
+static size_t hash_sorted(union box *const b, const char *const key) {
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < all->size; i++) n += hash_get(b, all->sorted[i]);
+	return n;
+}
+static size_t hash_iterate(union box *const b, const char *const key) {
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < b->hash.capacity; i++)
+		if(b->hash.table[i] && b->hash.table[i] != hash_deleted) n++;
+	return n;
+}
+static size_t hash_bytes(union box *const b)
+	{ return b->hash.capacity * sizeof *b->hash.table; }
+static void hash_clear(union box *const b)
+	{ free(b->hash.table), b->hash.table = 0; }
+
+/** @return The first of `b` not less than `key`. */
+static size_t sorted_lower(union box *const b, const char *const key) {
+	size_t lo = 0, hi = b->sorted.size;
+	while(lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if(strcmp(b->sorted.array[mid], key) < 0) lo = mid + 1; else hi = mid;
+	}
+	return lo;
+}
+static size_t sorted_get(union box *const b, const char *const key) {
+	return !!bsearch(&key, b->sorted.array, b->sorted.size,
+		sizeof *b->sorted.array, &cmp_key);
+}
+static size_t sorted_miss(union box *const b, const char *const key)
+	{ return sorted_get(b, miss_of(key)); }
+static size_t sorted_prefix(union box *const b, const char *const key) {
+	const char *const prefix = prefix_of(key);
+	const size_t len = strlen(prefix);
+	size_t i = sorted_lower(b, prefix), n = 0;
+	for( ; i < b->sorted.size
+		&& !strncmp(b->sorted.array[i], prefix, len); i++) n++;
+	return n;
+}
+static size_t sorted_sorted(union box *const b, const char *const key) {
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < all->size; i++) n += sorted_get(b, all->sorted[i]);
+	return n;
+}
+static size_t sorted_iterate(union box *const b, const char *const key) {
+	size_t i, n = 0;
+	(void)key;
+	for(i = 0; i < b->sorted.size; i++) if(b->sorted.array[i]) n++;
+	return n;
+}
+static size_t sorted_bytes(union box *const b)
+	{ return b->sorted.size * sizeof *b->sorted.array; }
+static void sorted_clear(union box *const b)
+	{ free(b->sorted.array), b->sorted.array = 0; }
+
+/** Sorted arrays can't be added to one at a time; they are built. */
+static int sorted_build(union box *const b, const struct keys *const keys) {
+	if(!(b->sorted.array = malloc(sizeof *b->sorted.array * keys->size)))
+		return 0;
+	memcpy(b->sorted.array, keys->key, sizeof *keys->key * keys->size);
+	qsort(b->sorted.array, keys->size, sizeof *b->sorted.array, &cmp_key);
+	b->sorted.size = keys->size;
+	return 1;
+}
+
+/* `HOT` is `GET` of `keys.hot`. `SORTED` is `GET` of all `keys.sorted`, and
+ `BATCH` is that all at once; `APPEND` builds anew from `keys.sorted`. These,
+ with `ITERATE`, are called once. */
+enum { ADD, GET, HOT, MISS, SORTED, BATCH, APPEND, PUT, PREFIX, ITERATE,
+	REMOVE, OPS };
+static const char *const op_names[] = { "add", "get", "hot", "miss", "sorted",
+	"batch", "append", "put", "prefix", "iterate", "remove" };
+
+static const struct structure {
+	const char *name;
+	int (*init)(union box *, const struct keys *);
+	int (*build)(union box *, const struct keys *);
+	op_fn op[OPS];
+	size_t (*bytes)(union box *);
+	void (*clear)(union box *);
+} structures[] = {
+	{ "trie", 0, 0, { &trie_add, &trie_get, &trie_get, &trie_miss,
+		&trie_sorted, &trie_batch, &trie_append, &trie_put, &trie_prefix,
+		&trie_iterate, &trie_remove }, &trie_bytes, &trie_clear },
+	{ "trie+bloom", 0, 0, { &bloom_add, &bloom_get, 0, &bloom_miss, 0, 0, 0,
+		&bloom_put, 0, 0, &bloom_remove }, &bloom_bytes, &bloom_clear },
+	{ "trie+cache", 0, 0, { &cache_add, &cache_get, &cache_get, 0, 0, 0, 0, 0,
+		0, 0, &cache_remove }, &cache_bytes, &cache_clear },
+	{ "hash", &hash_init, 0, { &hash_add, &hash_get, &hash_get, &hash_miss,
+		&hash_sorted, 0, 0, &hash_put, 0, &hash_iterate, &hash_remove },
+		&hash_bytes, &hash_clear },
+	{ "bsearch", 0, &sorted_build, { 0, &sorted_get, &sorted_get,
+		&sorted_miss, &sorted_sorted, 0, 0, 0, &sorted_prefix,
+		&sorted_iterate, 0 }, &sorted_bytes, &sorted_clear }
+};
+
+/* At most this many operations are timed individually for percentiles. */
+#define SAMPLES 65536
+static double samples[SAMPLES];
+/* Prefix scans are limited to this many. */
+#define PREFIXES 10000
+/* The result goes here so the operations aren't optimized out. */
+static volatile size_t sink;
+
+static int cmp_double(const void *a, const void *b) {
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/** Prints one line of the table. `count` is the number of samples, and
+ `counters` are hardware counts for all of `ops`. */
+static void row(const char *const structure, const char *const distribution,
+	const size_t size, const char *const op, const size_t ops,
+	const double elapsed, const size_t count, const size_t bytes,
+	double (*const counters)[PERF_COUNTERS]) {
+	unsigned c;
+	printf("%s,%s,%lu,%s,%lu,%.0f,", structure, distribution,
+		(unsigned long)size, op, (unsigned long)ops,
+		elapsed > 0 ? ops / elapsed * 1e9 : 0.0);
+	if(count) {
+		qsort(samples, count, sizeof *samples, &cmp_double);
+		printf("%.0f,%.0f,%.0f,", samples[count / 2],
+			samples[count * 9 / 10], samples[count * 99 / 100]);
+	} else {
+		printf(",,,");
+	}
+	printf("%.1f", size ? (double)bytes / size : 0.0);
+	for(c = 0; c < PERF_COUNTERS; c++) if(perf_is_open(c) && ops)
+		printf(",%.2f", (*counters)[c] / ops); else printf(",");
+	printf("\n");
+}
+
+/** Runs every operation of `s` on `keys`. @return Success. */
+static int run(const struct structure *const s, const char *const dist,
+	const struct keys *const keys) {
+	union box box;
+	double counters[PERF_COUNTERS];
+	size_t bytes = 0, o;
+	memset(&box, 0, sizeof box);
+	all = keys;
+	if(s->init && !s->init(&box, keys)) return 0;
+	if(s->build) { /* Instead of adding one at a time. */
+		const double t0 = now();
+		int is;
+		perf_start(), is = s->build(&box, keys), perf_stop(&counters);
+		if(!is) return 0;
+		row(s->name, dist, keys->size, op_names[ADD], keys->size,
+			now() - t0, 0, bytes = s->bytes(&box), &counters);
+	}
+	for(o = 0; o < OPS; o++) {
+		const op_fn op = s->op[o];
+		const int is_once = o == ITERATE || o == SORTED || o == BATCH
+			|| o == APPEND;
+		size_t i, ops, stride, count = 0, result = 0;
+		double t0, elapsed;
+		if(!op) continue;
+		ops = is_once ? 1 : o == PREFIX && keys->size > PREFIXES
+			? PREFIXES : keys->size;
+		stride = (ops + SAMPLES - 1) / SAMPLES;
+		errno = 0;
+		t0 = now();
+		perf_start();
+		for(i = 0; i < ops; i++) {
+			const char *const key = keys->key[o == HOT ? keys->hot[i] : i];
+			if(!is_once && !(i % stride)) {
+				const double t1 = now();
+				result += op(&box, key);
+				samples[count++] = now() - t1;
+			} else {
+				result += op(&box, key);
+			}
+		}
+		perf_stop(&counters);
+		elapsed = now() - t0;
+		sink = result;
+		if(errno) { perror(s->name); s->clear(&box); return 0; }
+		if(o == ADD) bytes = s->bytes(&box);
+		if(is_once) /* Report per item. */
+			ops = keys->size, count = 0;
+		row(s->name, dist, keys->size, op_names[o], ops, elapsed, count,
+			bytes, &counters);
+	}
+	s->clear(&box);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	struct keys keys = { 0, 0, 0, 0, 0 };
+	size_t d, s, size;
+	unsigned c;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 1000000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(!perf_open()) fprintf(stderr, "%s: hardware counters are not"
+		" available; leaving them blank.\n", argv[0]);
+	printf("structure,distribution,size,operation,ops,ops_per_s,"
+		"ns_p50,ns_p90,ns_p99,bytes_per_key");
+	for(c = 0; c < PERF_COUNTERS; c++) printf(",%s_per_op", perf_names[c]);
+	printf("\n");
+	for(size = 1000; size <= max; size *= 10) {
+		for(d = 0; d < sizeof distributions / sizeof *distributions; d++) {
+			rng_state = 2463534242UL, srand(1);
+			if(!keys_fill(&keys, distributions[d].generate, size))
+				goto catch;
+			for(s = 0; s < sizeof structures / sizeof *structures; s++)
+				if(!run(structures + s, distributions[d].name, &keys))
+				goto catch;
+			keys_(&keys);
+		}
+		if(size > (size_t)-1 / 10) break;
+	}
+	perf_close();
+	return EXIT_SUCCESS;
+catch:
+	perror("bench");
+	keys_(&keys), perf_close();
+	return EXIT_FAILURE;
+}
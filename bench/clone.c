@@ -0,0 +1,91 @@
+/* Benchmarks copying a trie. <fn:<T>trie_clone> copies the trees whole,
+ against adding every value to an idle trie, and <fn:<T>trie_union> with an
+ idle trie, which adds them in order. For comparison, `memcpy` copies as many
+ bytes as the trie has in one block. For sizes that are powers of ten from
+ 10^3 to the first argument, (default 10^6,) it outputs comma-separated
+ copies per second and the bytes of the trie per second. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free strtoul */
+#include <stdio.h>  /* printf sprintf perror */
+#include <string.h> /* memcpy */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+
+#define TRIE_NAME clone
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** Prints one line of the table for `copies` of `bytes`. */
+static void row(const char *const method, const size_t size,
+	const size_t bytes, const size_t copies, const double elapsed) {
+	printf("%s,%lu,%lu,%lu,%.6f,%.0f,%.3g\n", method, (unsigned long)size,
+		(unsigned long)bytes, (unsigned long)copies, elapsed / 1e9,
+		elapsed > 0 ? copies / elapsed * 1e9 : 0.0,
+		elapsed > 0 ? (double)bytes * copies / elapsed * 1e9 : 0.0);
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	struct clone_trie trie = TRIE_IDLE, copy = TRIE_IDLE, idle = TRIE_IDLE;
+	struct clone_trie_iterator it;
+	struct trie_stats stats;
+	char (*pool)[12] = 0, *a = 0, *b = 0;
+	const char *x;
+	size_t size, i, copies;
+	double t;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 1000000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(!(pool = malloc(sizeof *pool * max))) goto catch;
+	for(i = 0; i < max; i++) sprintf(pool[i], "%08lx",
+		(unsigned long)i * 2654435761UL & 0xffffffffUL);
+	printf("method,size,bytes,copies,s,copies_per_s,bytes_per_s\n");
+	for(size = 1000; size <= max; size *= 10) {
+		/* About the same work at each size. */
+		copies = 10000000 / size ? 10000000 / size : 1;
+		clone_trie_(&trie), errno = 0;
+		for(i = 0; i < size; i++) clone_trie_add(&trie, pool[i]);
+		if(errno || !clone_trie_stats(&trie, &stats)) goto catch;
+		t = now();
+		for(i = 0; i < copies; i++) {
+			clone_trie_prefix(&trie, "", &it), errno = 0;
+			while(x = clone_trie_next(&it)) clone_trie_add(&copy, x);
+			if(errno) goto catch;
+			clone_trie_(&copy);
+		}
+		row("add", size, stats.bytes, copies, now() - t);
+		t = now();
+		for(i = 0; i < copies; i++) {
+			if(!clone_trie_union(&copy, &trie, &idle)) goto catch;
+			clone_trie_(&copy);
+		}
+		row("union", size, stats.bytes, copies, now() - t);
+		t = now();
+		for(i = 0; i < copies; i++) {
+			if(!clone_trie_clone(&copy, &trie, 0)) goto catch;
+			clone_trie_(&copy);
+		}
+		row("clone", size, stats.bytes, copies, now() - t);
+		if(!(a = malloc(stats.bytes)) || !(b = malloc(stats.bytes)))
+			goto catch;
+		memset(a, 1, stats.bytes), t = now();
+		for(i = 0; i < copies; i++) memcpy(b, a, stats.bytes), a[i % 64] = b[0];
+		row("memcpy", size, stats.bytes, copies, now() - t);
+		free(a), free(b), a = b = 0;
+		if(size > (size_t)-1 / 10) break;
+	}
+	clone_trie_(&trie), free(pool);
+	return EXIT_SUCCESS;
+catch:
+	perror("clone");
+	clone_trie_(&trie), clone_trie_(&copy), free(pool), free(a), free(b);
+	return EXIT_FAILURE;
+}
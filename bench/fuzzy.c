@@ -0,0 +1,127 @@
+/* Benchmarks "did you mean" on a dictionary: the words within one or two
+ edits of a misspelling. <fn:<T>trie_fuzzy> goes down the trie once, against
+ making every string within the edits, (deleting, substituting, and
+ inserting letters of the dictionary,) and looking it up with
+ <fn:<T>trie_get>. There is no dictionary here; orcish is word-like. For sizes
+ that are powers of ten from 10^3 to the first argument, (default 10^5,) it
+ outputs comma-separated queries per second; the look-ups find some words
+ more than once. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free strtoul rand srand */
+#include <stdio.h>  /* printf perror */
+#include <string.h> /* strlen memcpy memmove */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+#include "../test/orcish.h"
+
+#define TRIE_NAME fuzzy
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define WORD 16
+#define QUERIES 200
+
+/* The letters of the dictionary, and what was found. */
+static char alphabet[UCHAR_MAX + 1];
+static size_t alphabet_size, lookups, found;
+
+/** Counts `word`. @implements <fuzzy>fuzzy_fn */
+static void count(const char *const word, const unsigned edits)
+	{ (void)word, (void)edits, found++; }
+
+/** Looks up every string within `edits` of `word` of `len` in `trie`. */
+static void candidates(const struct fuzzy_trie *const trie, char *const word,
+	const size_t len, const unsigned edits) {
+	char a[WORD + 4];
+	size_t i, j;
+	lookups++;
+	if(fuzzy_trie_get(trie, word)) found++;
+	if(!edits) return;
+	for(i = 0; i <= len; i++) {
+		if(i < len) { /* Deletion. */
+			memcpy(a, word, i), memcpy(a + i, word + i + 1, len - i);
+			candidates(trie, a, len - 1, edits - 1);
+		}
+		for(j = 0; j < alphabet_size; j++) {
+			if(i < len && word[i] != alphabet[j]) { /* Substitution. */
+				memcpy(a, word, len + 1), a[i] = alphabet[j];
+				candidates(trie, a, len, edits - 1);
+			}
+			if(len + 1 < sizeof a - 1) { /* Insertion. */
+				memcpy(a, word, i), a[i] = alphabet[j];
+				memcpy(a + i + 1, word + i, len - i + 1);
+				candidates(trie, a, len + 1, edits - 1);
+			}
+		}
+	}
+}
+
+/** Prints one line of the table. */
+static void row(const char *const method, const size_t size,
+	const unsigned edits, const size_t queries, const double elapsed) {
+	printf("%s,%lu,%u,%lu,%lu,%lu,%.6f,%.0f\n", method, (unsigned long)size,
+		edits, (unsigned long)queries, (unsigned long)lookups,
+		(unsigned long)found, elapsed / 1e9,
+		elapsed > 0 ? queries / elapsed * 1e9 : 0.0);
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 100000;
+	struct fuzzy_trie trie = TRIE_IDLE;
+	char (*pool)[WORD] = 0, query[QUERIES][WORD];
+	size_t size, i, len, queries;
+	unsigned edits;
+	double t;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 100000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	srand(1);
+	if(!(pool = malloc(sizeof *pool * max))) goto catch;
+	for(i = 0; i < max; i++) {
+		const char *a;
+		orcish(pool[i], WORD);
+		for(a = pool[i]; *a; a++) if(!memchr(alphabet, *a, alphabet_size))
+			alphabet[alphabet_size++] = *a;
+	}
+	printf("method,size,edits,queries,lookups,found,s,queries_per_s\n");
+	for(size = 1000; size <= max; size *= 10) {
+		fuzzy_trie_(&trie), errno = 0;
+		for(i = 0; i < size; i++) fuzzy_trie_add(&trie, pool[i]);
+		if(errno) goto catch;
+		/* Misspell a word in the dictionary by one substitution. */
+		for(i = 0; i < QUERIES; i++) {
+			memcpy(query[i], pool[(size_t)rand() % size], WORD);
+			if(len = strlen(query[i]))
+				query[i][(size_t)rand() % len] = alphabet[(size_t)rand()
+				% alphabet_size];
+		}
+		for(edits = 1; edits <= 2; edits++) {
+			lookups = found = 0, t = now();
+			for(i = 0; i < QUERIES; i++)
+				if(!fuzzy_trie_fuzzy(&trie, query[i], edits, &count))
+					goto catch;
+			row("fuzzy", size, edits, QUERIES, now() - t);
+			/* Two edits is hundreds of thousands of look-ups a query. */
+			queries = edits < 2 ? QUERIES : QUERIES / 20;
+			lookups = found = 0, t = now();
+			for(i = 0; i < queries; i++)
+				candidates(&trie, query[i], strlen(query[i]), edits);
+			row("get", size, edits, queries, now() - t);
+		}
+		if(size > (size_t)-1 / 10) break;
+	}
+	fuzzy_trie_(&trie), free(pool);
+	return EXIT_SUCCESS;
+catch:
+	perror("fuzzy");
+	fuzzy_trie_(&trie), free(pool);
+	return EXIT_FAILURE;
+}
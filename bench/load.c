@@ -0,0 +1,156 @@
+/* Loads a file of newline-delimited keys into a trie of strings without
+ copying them. The file is mapped private, (copy-on-write,) and each newline
+ is replaced by a terminator, so the keys point into the mapping. With more
+ than one thread, each adds it's part of the file to it's own trie, and then
+ they are merged in pairs with <fn:<T>trie_union>. Outputs comma-separated
+ seconds and keys per second. Takes the file name and, optionally, the number
+ of threads. */
+
+#define _POSIX_C_SOURCE 200112L /* clock_gettime mmap pthread */
+#include <stdlib.h>   /* EXIT malloc free strtoul */
+#include <stdio.h>    /* printf perror */
+#include <string.h>   /* memchr memcpy */
+#include <errno.h>    /* errno */
+#include <time.h>     /* clock_gettime */
+#include <fcntl.h>    /* open */
+#include <unistd.h>   /* close */
+#include <sys/mman.h> /* mmap munmap */
+#include <sys/stat.h> /* fstat */
+#include <pthread.h>  /* pthread_create pthread_join */
+
+#define TRIE_NAME load
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define THREADS_MAX 64
+
+/* The part of the file `[a, z)` that one thread adds to `trie`, or, when
+ merging, the tries that it unions. */
+struct part {
+	char *a, *z;
+	struct load_trie trie, *left, *right;
+	size_t lines;
+	int error;
+};
+
+/** Terminates and adds every line of `part`. @implements pthread_create */
+static void *add_lines(void *const void_part) {
+	struct part *const part = void_part;
+	char *a = part->a, *z;
+	errno = 0;
+	while(a < part->z) {
+		if(!(z = memchr(a, '\n', (size_t)(part->z - a)))) z = part->z;
+		if(z > a && z[-1] == '\r') z[-1] = '\0';
+		*z = '\0';
+		if(*a) { part->lines++; load_trie_add(&part->trie, a); }
+		if(errno) { part->error = errno; break; }
+		a = z + 1;
+	}
+	return 0;
+}
+
+/** Moves the union of `left` and `right` into `left`.
+ @implements pthread_create */
+static void *merge(void *const void_part) {
+	struct part *const part = void_part;
+	struct load_trie out = TRIE_IDLE;
+	errno = 0;
+	if(!load_trie_union(&out, part->left, part->right)) part->error = errno;
+	load_trie_(part->left), load_trie_(part->right);
+	*part->left = out;
+	return 0;
+}
+
+/** Waits for the first `n` of `thread`. */
+static void join(pthread_t *const thread, size_t n)
+	{ while(n) pthread_join(thread[--n], 0); }
+
+int main(int argc, char **argv) {
+	const unsigned long threads = argc > 2 ? strtoul(argv[2], 0, 10) : 1;
+	static struct part parts[THREADS_MAX];
+	pthread_t thread[THREADS_MAX];
+	struct stat st;
+	char *map = MAP_FAILED, *last = 0;
+	size_t size = 0, lines = 0, keys = 0, i, step;
+	struct load_trie_iterator it;
+	double t0, t1, t2;
+	int fd = -1, is_success = 0;
+	if(argc < 2 || argc > 3 || !threads || threads > THREADS_MAX) {
+		fprintf(stderr, "Usage: %s <file of keys, one per line> [threads,"
+			" 1 to %u]\n", argv[0], THREADS_MAX);
+		return EXIT_FAILURE;
+	}
+	t0 = now();
+	if((fd = open(argv[1], O_RDONLY)) == -1 || fstat(fd, &st) == -1)
+		goto catch;
+	if(!(size = (size_t)st.st_size)) { errno = EDOM; goto catch; }
+	if((map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0))
+		== MAP_FAILED) goto catch;
+	close(fd), fd = -1;
+	/* The last line needs a terminator past the end of the map. */
+	if(map[size - 1] != '\n') {
+		char *a = map + size;
+		size_t len;
+		while(a > map && a[-1] != '\n') a--;
+		len = (size_t)(map + size - a);
+		if(!(last = malloc(len + 1))) goto catch;
+		memcpy(last, a, len), last[len] = '\0';
+		size = (size_t)(a - map);
+	}
+	/* Split into `threads` parts at line boundaries. */
+	for(i = 0; i < threads; i++) {
+		char *z = map + size * (i + 1) / threads;
+		parts[i].a = i ? parts[i - 1].z : map;
+		if(z < parts[i].a) z = parts[i].a;
+		while(z < map + size && z > map && z[-1] != '\n') z++;
+		parts[i].z = z;
+	}
+	for(i = 0; i < threads; i++)
+		if(pthread_create(thread + i, 0, &add_lines, parts + i))
+		{ join(thread, i); goto catch; }
+	join(thread, threads);
+	if(last) {
+		errno = 0, parts[0].lines++, load_trie_add(&parts[0].trie, last);
+		if(errno) parts[0].error = errno;
+	}
+	t1 = now();
+	/* Merge in pairs. */
+	for(step = 1; step < threads; step *= 2) {
+		size_t n = 0;
+		for(i = 0; i + step < threads; i += 2 * step, n++) {
+			parts[i].left = &parts[i].trie;
+			parts[i].right = &parts[i + step].trie;
+			if(pthread_create(thread + n, 0, &merge, parts + i))
+				{ join(thread, n); goto catch; }
+		}
+		join(thread, n);
+	}
+	t2 = now();
+	for(i = 0; i < threads; i++) {
+		if(parts[i].error) { errno = parts[i].error; goto catch; }
+		lines += parts[i].lines;
+	}
+	load_trie_prefix(&parts[0].trie, "", &it);
+	while(load_trie_next(&it)) keys++;
+	printf("threads,lines,keys,bytes,add_s,merge_s,total_s,keys_per_s\n");
+	printf("%lu,%lu,%lu,%lu,%.6f,%.6f,%.6f,%.0f\n", threads,
+		(unsigned long)lines, (unsigned long)keys, (unsigned long)st.st_size,
+		(t1 - t0) / 1e9, (t2 - t1) / 1e9, (t2 - t0) / 1e9,
+		t2 > t0 ? lines / (t2 - t0) * 1e9 : 0.0);
+	is_success = 1;
+	goto finally;
+catch:
+	perror(argv[1]);
+finally:
+	for(i = 0; i < threads; i++) load_trie_(&parts[i].trie);
+	if(fd != -1) close(fd);
+	if(map != MAP_FAILED) munmap(map, (size_t)st.st_size);
+	free(last);
+	return is_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
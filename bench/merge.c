@@ -0,0 +1,106 @@
+/* Benchmarks going through many tries in order, as if there were one trie
+ per time window, and some keys were in more than one. <fn:<T>trie_merge>
+ goes through a loser tree of the iterators, against concatenating every
+ trie into an array and sorting it. For sizes that are powers of ten from
+ 10^3 to the first argument, (default 10^6,) split over `WINDOWS` tries, it
+ outputs comma-separated keys per second. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free qsort strtoul */
+#include <stdio.h>  /* printf sprintf perror */
+#include <string.h> /* strcmp */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+
+#define TRIE_NAME merge
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define WINDOWS 32
+
+/** Orders by key. @implements qsort */
+static int by_key(const void *const a, const void *const b)
+	{ return strcmp(*(const char *const *)a, *(const char *const *)b); }
+
+/** Prints one line of the table. */
+static void row(const char *const method, const size_t size,
+	const size_t keys, const double elapsed) {
+	printf("%s,%u,%lu,%lu,%.6f,%.0f\n", method, WINDOWS, (unsigned long)size,
+		(unsigned long)keys, elapsed / 1e9,
+		elapsed > 0 ? keys / elapsed * 1e9 : 0.0);
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	struct merge_trie window[WINDOWS];
+	struct merge_trie_merge merge;
+	struct merge_trie_iterator it;
+	char (*pool)[12] = 0;
+	const char **all = 0, *x;
+	size_t size, i, n, unique, collected;
+	double t;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 1000000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	for(i = 0; i < WINDOWS; i++) merge_trie(window + i);
+	if(!(pool = malloc(sizeof *pool * max))
+		|| !(all = malloc(sizeof *all * max))) goto catch;
+	printf("method,tries,size,keys,s,keys_per_s\n");
+	for(size = 1000; size <= max; size *= 10) {
+		/* The last quarter are the first keys again, in the next window. */
+		const size_t first = size - size / 4;
+		for(i = 0; i < WINDOWS; i++) merge_trie_(window + i);
+		errno = 0;
+		for(i = 0; i < size; i++) {
+			const size_t k = i < first ? i : i - first;
+			sprintf(pool[i], "%08lx",
+				(unsigned long)k * 2654435761UL & 0xffffffffUL);
+			merge_trie_add(window + (k + (i >= first)) % WINDOWS, pool[i]);
+		}
+		if(errno) goto catch;
+		t = now();
+		if(!merge_trie_merge(&merge, window, WINDOWS, "", TRIE_MERGE_ALL))
+			goto catch;
+		for(n = 0; x = merge_trie_merge_next(&merge); n++);
+		merge_trie_merge_(&merge), row("merge_all", size, n, now() - t);
+		if(n != size) { errno = EDOM; goto catch; }
+		t = now();
+		if(!merge_trie_merge(&merge, window, WINDOWS, "", TRIE_MERGE_FIRST))
+			goto catch;
+		for(unique = 0; x = merge_trie_merge_next(&merge); unique++);
+		merge_trie_merge_(&merge), row("merge_first", size, unique, now() - t);
+		t = now();
+		for(n = 0, i = 0; i < WINDOWS; i++) {
+			merge_trie_prefix(window + i, "", &it);
+			while(x = merge_trie_next(&it)) all[n++] = x;
+		}
+		qsort(all, n, sizeof *all, &by_key);
+		row("sort", size, n, now() - t);
+		t = now();
+		for(n = 0, i = 0; i < WINDOWS; i++) {
+			merge_trie_prefix(window + i, "", &it);
+			while(x = merge_trie_next(&it)) all[n++] = x;
+		}
+		qsort(all, collected = n, sizeof *all, &by_key);
+		for(n = !!n, i = 1; i < collected; i++)
+			if(strcmp(all[n - 1], all[i])) all[n++] = all[i];
+		row("sort_unique", size, n, now() - t);
+		if(n != unique) { errno = EDOM; goto catch; }
+		if(size > (size_t)-1 / 10) break;
+	}
+	for(i = 0; i < WINDOWS; i++) merge_trie_(window + i);
+	free(pool), free(all);
+	return EXIT_SUCCESS;
+catch:
+	perror("merge");
+	for(i = 0; i < WINDOWS; i++) merge_trie_(window + i);
+	free(pool), free(all);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,96 @@
+/* Hardware counters for the benchmark; see <perf.h>. */
+
+#ifdef __linux__ /* <!-- linux */
+#define _GNU_SOURCE /* syscall */
+#include <string.h>       /* memset */
+#include <unistd.h>       /* syscall read close */
+#include <sys/ioctl.h>    /* ioctl */
+#include <sys/syscall.h>  /* SYS_perf_event_open */
+#include <linux/perf_event.h>
+#endif /* linux --> */
+#include "perf.h"
+
+const char *const perf_names[] = { "instructions", "l1d_misses",
+	"llc_misses", "dtlb_misses", "branch_misses" };
+
+#ifdef __linux__ /* <!-- linux */
+
+/* File descriptors, or -1 if that counter is not available. */
+static int fds[PERF_COUNTERS] = { -1, -1, -1, -1, -1 };
+
+#define CACHE(cache, op, result) (PERF_COUNT_HW_CACHE_##cache \
+	| PERF_COUNT_HW_CACHE_OP_##op << 8 \
+	| PERF_COUNT_HW_CACHE_RESULT_##result << 16)
+
+/** Opens whatever counters this process is allowed to.
+ @return Whether any are open. */
+int perf_open(void) {
+	static const struct { unsigned type; unsigned long config; }
+		events[] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, CACHE(L1D, READ, MISS) },
+		{ PERF_TYPE_HW_CACHE, CACHE(LL, READ, MISS) },
+		{ PERF_TYPE_HW_CACHE, CACHE(DTLB, READ, MISS) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES } };
+	struct perf_event_attr attr;
+	int is_any = 0;
+	unsigned i;
+	for(i = 0; i < PERF_COUNTERS; i++) {
+		memset(&attr, 0, sizeof attr);
+		attr.size = sizeof attr;
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if(fds[i] >= 0) is_any = 1;
+	}
+	return is_any;
+}
+
+/** Closes the counters. */
+void perf_close(void) {
+	unsigned i;
+	for(i = 0; i < PERF_COUNTERS; i++)
+		if(fds[i] >= 0) close(fds[i]), fds[i] = -1;
+}
+
+/** @return Whether `counter` is being counted. */
+int perf_is_open(const enum perf_counter counter)
+	{ return fds[counter] >= 0; }
+
+/** Zeros and starts the counters. */
+void perf_start(void) {
+	unsigned i;
+	for(i = 0; i < PERF_COUNTERS; i++) if(fds[i] >= 0)
+		ioctl(fds[i], PERF_EVENT_IOC_RESET, 0),
+		ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+/** Stops the counters and puts the counts in `counts`; ones that are not
+ open are zero. */
+void perf_stop(double (*const counts)[PERF_COUNTERS]) {
+	unsigned i;
+	for(i = 0; i < PERF_COUNTERS; i++) {
+		__u64 count;
+		(*counts)[i] = 0;
+		if(fds[i] < 0) continue;
+		ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		if(read(fds[i], &count, sizeof count) == sizeof count)
+			(*counts)[i] = (double)count;
+	}
+}
+
+#else /* linux --><!-- !linux */
+
+int perf_open(void) { return 0; }
+void perf_close(void) {}
+int perf_is_open(const enum perf_counter counter) { (void)counter; return 0; }
+void perf_start(void) {}
+void perf_stop(double (*const counts)[PERF_COUNTERS]) {
+	unsigned i;
+	for(i = 0; i < PERF_COUNTERS; i++) (*counts)[i] = 0;
+}
+
+#endif /* !linux --> */
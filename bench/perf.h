@@ -0,0 +1,16 @@
+/* Hardware counters around a region of code with `perf_event_open` on Linux.
+ Where they are not available, (other systems, containers, or
+ `perf_event_paranoid`,) <fn:perf_open> returns false and the rest do
+ nothing, so the benchmark still runs. */
+
+enum perf_counter { PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES,
+	PERF_DTLB_MISSES, PERF_BRANCH_MISSES, PERF_COUNTERS };
+
+/* Names of <tag:perf_counter> for column headings. */
+extern const char *const perf_names[PERF_COUNTERS];
+
+int perf_open(void);
+void perf_close(void);
+int perf_is_open(enum perf_counter);
+void perf_start(void);
+void perf_stop(double (*)[PERF_COUNTERS]);
@@ -0,0 +1,206 @@
+/* Benchmarks recovery of a trie of strings with `TRIE_JOURNAL`. For sizes
+ that are powers of ten from 10^3 to the first argument, (default 10^6,) it
+ journals adding that many keys, and then a tenth more changes. It outputs
+ comma-separated seconds for: journalling with `fsync` every `group` records;
+ replaying the journal a call at a time, as one would without it; replaying it
+ in bulk; taking a checkpoint; recovering from the checkpoint and the tail;
+ and a front-coded `TRIE_DUMP` and restoring it, with the bytes of the files.
+ Last, it checks that a record cut short at the end of the tail is truncated
+ before the tail is appended to again. The files are temporary. */
+
+#define _POSIX_C_SOURCE 200112L /* clock_gettime fsync fileno */
+#include <stdlib.h> /* EXIT malloc free strtoul */
+#include <stdio.h>  /* printf sprintf tmpfile fread perror */
+#include <string.h> /* strchr */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+#include <unistd.h> /* fsync ftruncate */
+
+#define TRIE_NAME recover
+#define TRIE_JOURNAL
+#define TRIE_DUMP
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** Makes the journal in `fp` durable. @implements trie_sync_fn */
+static int sync_file(FILE *const fp) { return !fsync(fileno(fp)); }
+
+/** Reads all of `fp` from the start into `*buffer` of `*size`.
+ @return Success. */
+static int slurp(FILE *const fp, char **const buffer, size_t *const size) {
+	long end;
+	*buffer = 0, *size = 0;
+	if(fseek(fp, 0, SEEK_END) || (end = ftell(fp)) < 0
+		|| fseek(fp, 0, SEEK_SET)
+		|| !(*buffer = malloc((size_t)end + 1))) return 0;
+	*size = fread(*buffer, 1, (size_t)end, fp);
+	return *size == (size_t)end;
+}
+
+/* Groups to commit with `fsync`; one is a sync on every change. */
+static const size_t groups[] = { 1, 16, 256, 4096 };
+/* Syncs are slow; the journal is timed on at most this many per group. */
+#define SYNCS 1000
+
+/** Prints one line of the table. */
+static void row(const char *const phase, const size_t size,
+	const size_t group, const size_t records, const double elapsed,
+	const size_t bytes) {
+	printf("%s,%lu,", phase, (unsigned long)size);
+	if(group) printf("%lu", (unsigned long)group);
+	printf(",%lu,%.6f,%.0f,", (unsigned long)records, elapsed / 1e9,
+		elapsed > 0 ? records / elapsed * 1e9 : 0.0);
+	if(bytes) printf("%lu", (unsigned long)bytes);
+	printf("\n");
+}
+
+/** Journals changes to `size` keys in `pool`, and recovers them.
+ @return Success. */
+static int run(const size_t size, char (*const pool)[12]) {
+	struct recover_trie trie = TRIE_IDLE, back = TRIE_IDLE;
+	struct trie_journal journal, checkpoint;
+	FILE *fp = 0, *tail = 0, *snapshot = 0;
+	char *log = 0, *log_tail = 0, *log_snapshot = 0, *log_torn = 0;
+	const char *a;
+	size_t log_size, tail_size, snapshot_size, torn_size, valid, records, i,
+		g;
+	double t;
+	struct trie_stats stats;
+	void *storage = 0;
+	int is_success = 0;
+	/* Journalling at each group. */
+	for(g = 0; g < sizeof groups / sizeof *groups; g++) {
+		const size_t n = size < groups[g] * SYNCS ? size : groups[g] * SYNCS;
+		if(!(fp = tmpfile())) goto catch;
+		trie_journal(&journal, fp, groups[g], &sync_file);
+		recover_trie_journal(&trie, &journal);
+		t = now();
+		for(i = 0; i < n; i++) recover_trie_add(&trie, pool[i]);
+		if(!trie_journal_commit(&journal)) goto catch;
+		row("journal", size, groups[g], n, now() - t, 0);
+		recover_trie_(&trie), fclose(fp), fp = 0;
+	}
+	/* The whole journal, and a tenth more after a checkpoint in `tail`. */
+	if(!(fp = tmpfile()) || !(tail = tmpfile()) || !(snapshot = tmpfile()))
+		goto catch;
+	trie_journal(&journal, fp, groups[3], &sync_file);
+	recover_trie_journal(&trie, &journal);
+	errno = 0;
+	for(i = 0; i < size; i++) recover_trie_add(&trie, pool[i]);
+	if(errno || !trie_journal_commit(&journal)) goto catch;
+	trie_journal(&checkpoint, snapshot, groups[3], &sync_file);
+	t = now();
+	if(!recover_trie_checkpoint(&trie, &checkpoint)) goto catch;
+	row("checkpoint", size, 0, size, now() - t, 0);
+	trie_journal(&journal, tail, groups[3], &sync_file);
+	recover_trie_journal(&trie, &journal);
+	for(i = 0; i < size / 10; i++) {
+		if(i & 1) recover_trie_remove(&trie, pool[i * 7 % size]);
+		else recover_trie_add(&trie, pool[size + i]);
+	}
+	if(errno || !trie_journal_commit(&journal)) goto catch;
+	recover_trie_journal(&trie, 0), recover_trie_(&trie);
+	if(!slurp(fp, &log, &log_size) || !slurp(tail, &log_tail, &tail_size)
+		|| !slurp(snapshot, &log_snapshot, &snapshot_size)) goto catch;
+	/* A call at a time. */
+	t = now(), records = 0;
+	for(a = log; a < log + log_size; a = strchr(a + 1, '\0') + 1, records++)
+		recover_trie_add(&trie, a + 1);
+	for(a = log_tail; a < log_tail + tail_size;
+		a = strchr(a + 1, '\0') + 1, records++)
+		if(*a == TRIE_RECORD_REMOVE) recover_trie_remove(&trie, a + 1);
+		else recover_trie_add(&trie, a + 1);
+	row("replay_each", size, 0, records, now() - t, log_size + tail_size);
+	if(errno) goto catch;
+	recover_trie_(&trie);
+	/* In bulk. */
+	t = now();
+	if(!recover_trie_journal_replay(&trie, log, log_size, 0)
+		|| !recover_trie_journal_replay(&trie, log_tail, tail_size, 0))
+		goto catch;
+	row("replay_bulk", size, 0, records, now() - t, 0);
+	/* From the checkpoint. */
+	t = now();
+	if(!recover_trie_journal_replay(&back, log_snapshot, snapshot_size, 0)
+		|| !recover_trie_journal_replay(&back, log_tail, tail_size, 0))
+		goto catch;
+	row("recover", size, 0, size + size / 10, now() - t,
+		snapshot_size + tail_size);
+	/* The same as a front-coded dump. */
+	fclose(snapshot);
+	if(!(snapshot = tmpfile()) || !recover_trie_stats(&back, &stats))
+		goto catch;
+	t = now();
+	if(!recover_trie_dump(&back, snapshot) || fflush(snapshot)
+		|| fsync(fileno(snapshot))) goto catch;
+	row("dump", size, 0, stats.keys, now() - t, 0);
+	recover_trie_(&back), free(log_snapshot), log_snapshot = 0;
+	if(!slurp(snapshot, &log_snapshot, &snapshot_size)) goto catch;
+	t = now();
+	if(!recover_trie_restore(&back, log_snapshot, snapshot_size, &storage))
+		goto catch;
+	row("restore", size, 0, stats.keys, now() - t, snapshot_size);
+	/* A crash while appending "tor": the tail is cut back to where the last
+	 whole record ends, so the record of "mended" isn't glued to it. */
+	recover_trie_(&trie);
+	if(fseek(tail, 0, SEEK_END) || fputc(TRIE_RECORD_ADD, tail) == EOF
+		|| fputs("tor", tail) == EOF || fflush(tail)
+		|| !slurp(tail, &log_torn, &torn_size)
+		|| !recover_trie_journal_replay(&trie, log_torn, torn_size, &valid))
+		goto catch;
+	if(valid != tail_size || recover_trie_get(&trie, "tor"))
+		{ errno = EDOM; goto catch; }
+	recover_trie_(&trie), free(log_torn), log_torn = 0;
+	if(ftruncate(fileno(tail), (off_t)valid) || fseek(tail, 0, SEEK_END))
+		goto catch;
+	trie_journal(&journal, tail, 1, &sync_file);
+	recover_trie_journal(&trie, &journal), errno = 0;
+	recover_trie_add(&trie, "mended");
+	recover_trie_journal(&trie, 0), recover_trie_(&trie);
+	if(errno || journal.error || !slurp(tail, &log_torn, &torn_size)
+		|| !recover_trie_journal_replay(&trie, log_torn, torn_size, &valid))
+		goto catch;
+	if(valid != torn_size || torn_size != tail_size + 1 + sizeof "mended"
+		|| !recover_trie_get(&trie, "mended")) { errno = EDOM; goto catch; }
+	is_success = 1;
+catch:
+	recover_trie_(&trie), recover_trie_(&back);
+	if(fp) fclose(fp);
+	if(tail) fclose(tail);
+	if(snapshot) fclose(snapshot);
+	free(log), free(log_tail), free(log_snapshot), free(log_torn),
+		free(storage);
+	return is_success;
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	char (*pool)[12] = 0;
+	size_t size, i;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 1000000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	/* Unique keys in no order, and a tenth more for after the checkpoint. */
+	if(!(pool = malloc(sizeof *pool * (max + max / 10)))) goto catch;
+	for(i = 0; i < max + max / 10; i++)
+		sprintf(pool[i], "%08lx", (unsigned long)i * 2654435761UL
+		& 0xffffffffUL);
+	printf("phase,size,group,records,s,records_per_s,bytes\n");
+	for(size = 1000; size <= max; size *= 10) {
+		if(!run(size, pool)) goto catch;
+		if(size > (size_t)-1 / 10) break;
+	}
+	free(pool);
+	return EXIT_SUCCESS;
+catch:
+	perror("recover");
+	free(pool);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+/* Replays a log from a trie with `TRIE_RECORD` on a trie of strings, as fast
+ as it can, and outputs comma-separated throughput and latency percentiles
+ of each operation. The log is read into memory first; the keys stay in it.
+ Takes the file name as the argument, or reads `stdin`. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc realloc free qsort */
+#include <stdio.h>  /* printf fopen fread perror */
+#include <string.h> /* memchr */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+#include "perf.h"
+
+#define TRIE_NAME replay
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+struct record { enum trie_record_op op; const char *key; };
+
+static const struct { enum trie_record_op op; const char *name; } ops[] = {
+	{ TRIE_RECORD_GET, "get" }, { TRIE_RECORD_ADD, "add" },
+	{ TRIE_RECORD_PUT, "put" }, { TRIE_RECORD_REMOVE, "remove" },
+	{ TRIE_RECORD_PREFIX, "prefix" } };
+#define OPS (sizeof ops / sizeof *ops)
+
+/* At most this many operations of each are timed individually. */
+#define SAMPLES 65536
+static struct { double ns[SAMPLES]; size_t count, ops; } samples[OPS];
+/* The result goes here so the operations aren't optimized out. */
+static volatile size_t sink;
+
+/** @return The index of `op` in `ops` or `OPS`. */
+static size_t op_index(const int op) {
+	size_t o;
+	for(o = 0; o < OPS && (int)ops[o].op != op; o++);
+	return o;
+}
+
+/** Reads all of `fp` into `*buffer` of `*size`. @return Success. */
+static int slurp(FILE *const fp, char **const buffer, size_t *const size) {
+	size_t capacity = 0, got;
+	*buffer = 0, *size = 0;
+	do {
+		if(*size == capacity) {
+			char *b;
+			capacity = capacity ? capacity * 2 : 65536;
+			if(!(b = realloc(*buffer, capacity))) return 0;
+			*buffer = b;
+		}
+		*size += got = fread(*buffer + *size, 1, capacity - *size, fp);
+	} while(got);
+	return !ferror(fp);
+}
+
+/** Splits `log` of `size` into `*records`. @return Success; `EDOM` if it's
+ not a log. */
+static int parse(char *const log, const size_t size,
+	struct record **const records, size_t *const records_size) {
+	const char *a = log, *const end = log + size, *z;
+	size_t n = 0;
+	*records = 0, *records_size = 0;
+	while(a < end) {
+		if(op_index(*a) == OPS || !(z = memchr(a + 1, '\0', end - a - 1)))
+			return errno = EDOM, 0;
+		a = z + 1, n++;
+	}
+	if(n && !(*records = malloc(sizeof **records * n))) return 0;
+	for(a = log; a < end; a = strchr(a + 1, '\0') + 1)
+		(*records)[(*records_size)++].op = (enum trie_record_op)*a,
+		(*records)[*records_size - 1].key = a + 1;
+	return 1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+	const double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+	FILE *fp = 0;
+	char *log = 0;
+	size_t size, records_size, i, o, stride;
+	struct record *records = 0;
+	struct replay_trie trie = TRIE_IDLE;
+	double counters[PERF_COUNTERS], elapsed;
+	unsigned c;
+	int is_perf, is_success = 0;
+	if(argc > 2) {
+		fprintf(stderr, "Usage: %s [log from TRIE_RECORD, default stdin]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(!(fp = argc > 1 ? fopen(argv[1], "rb") : stdin)
+		|| !slurp(fp, &log, &size)
+		|| !parse(log, size, &records, &records_size)) goto catch;
+	if(fp != stdin) fclose(fp);
+	fp = 0;
+	is_perf = perf_open();
+	stride = records_size / SAMPLES + 1;
+
+	/* The replay. */
+	errno = 0;
+	elapsed = now();
+	perf_start();
+	for(i = 0; i < records_size; i++) {
+		const struct record *const r = records + i;
+		const size_t is_sample = !(i % stride);
+		struct replay_trie_iterator it;
+		double t0 = 0;
+		o = op_index(r->op);
+		if(is_sample) t0 = now();
+		switch(r->op) {
+		case TRIE_RECORD_GET: sink = !!replay_trie_get(&trie, r->key); break;
+		case TRIE_RECORD_ADD: sink = (size_t)replay_trie_add(&trie, r->key);
+			break;
+		case TRIE_RECORD_PUT:
+			sink = (size_t)replay_trie_put(&trie, r->key, 0); break;
+		case TRIE_RECORD_REMOVE:
+			sink = !!replay_trie_remove(&trie, r->key); break;
+		case TRIE_RECORD_PREFIX:
+			replay_trie_prefix(&trie, r->key, &it);
+			while(replay_trie_next(&it)) sink++;
+			break;
+		}
+		if(is_sample && samples[o].count < SAMPLES)
+			samples[o].ns[samples[o].count++] = now() - t0;
+		samples[o].ops++;
+	}
+	perf_stop(&counters);
+	elapsed = now() - elapsed;
+	if(errno) goto catch;
+
+	/* Output. */
+	printf("operation,ops,ops_per_s,ns_p50,ns_p90,ns_p99,ns_p999");
+	for(c = 0; c < PERF_COUNTERS; c++) printf(",%s_per_op", perf_names[c]);
+	printf("\n");
+	for(o = 0; o < OPS; o++) {
+		const size_t n = samples[o].count;
+		if(!samples[o].ops) continue;
+		printf("%s,%lu,", ops[o].name, (unsigned long)samples[o].ops);
+		if(n) qsort(samples[o].ns, n, sizeof *samples[o].ns, &cmp_double),
+			printf(",%.0f,%.0f,%.0f,%.0f", samples[o].ns[n / 2],
+			samples[o].ns[n * 9 / 10], samples[o].ns[n * 99 / 100],
+			samples[o].ns[n * 999 / 1000]);
+		else printf(",,,,");
+		for(c = 0; c < PERF_COUNTERS; c++) printf(",");
+		printf("\n");
+	}
+	printf("all,%lu,%.0f,,,,", (unsigned long)records_size,
+		elapsed > 0 ? records_size / elapsed * 1e9 : 0.0);
+	for(c = 0; c < PERF_COUNTERS; c++)
+		if(is_perf && perf_is_open(c) && records_size)
+		printf(",%.2f", counters[c] / records_size); else printf(",");
+	printf("\n");
+	is_success = 1;
+	goto finally;
+catch:
+	perror(argc > 1 ? argv[1] : "stdin");
+finally:
+	if(fp && fp != stdin) fclose(fp);
+	replay_trie_(&trie), perf_close();
+	free(records), free(log);
+	return is_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+/* Benchmarks a routing table, where the longest stored prefix of a path is
+ it's route. <fn:<T>trie_longest_prefix> goes down the trie once, against
+ truncating the path a byte at a time and looking it up with
+ <fn:<T>trie_get>. The routes are hierarchical, each extending an earlier one
+ with a word-like orcish name, and an eighth of the paths have no route. For
+ sizes that are powers of ten from 10^3 to the first argument, (default 10^5,)
+ it outputs comma-separated paths per second. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free strtoul rand srand */
+#include <stdio.h>  /* printf sprintf perror */
+#include <string.h> /* strcpy strcat strlen */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+#include "../test/orcish.h"
+
+#define TRIE_NAME route
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define ROUTE 128
+#define PATHS 100000
+
+/** Prints one line of the table. */
+static void row(const char *const method, const size_t size,
+	const size_t found, const double elapsed) {
+	printf("%s,%lu,%u,%lu,%.6f,%.0f\n", method, (unsigned long)size, PATHS,
+		(unsigned long)found, elapsed / 1e9,
+		elapsed > 0 ? PATHS / elapsed * 1e9 : 0.0);
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 100000;
+	struct route_trie trie = TRIE_IDLE;
+	char (*route)[ROUTE] = 0, (*path)[ROUTE + 12] = 0, truncate[ROUTE + 12];
+	const char *x;
+	size_t size, i, j, found;
+	double t;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 100000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	srand(1);
+	if(!(route = malloc(sizeof *route * max))
+		|| !(path = malloc(sizeof *path * PATHS))) goto catch;
+	strcpy(route[0], "/");
+	for(i = 1; i < max; i++) {
+		const char *const up = route[(size_t)rand() % i];
+		char name[12];
+		orcish(name, sizeof name);
+		if(strlen(up) + strlen(name) + 2 > sizeof *route)
+			{ strcpy(route[i], up); continue; }
+		strcpy(route[i], up), strcat(route[i], name), strcat(route[i], "/");
+	}
+	printf("method,size,paths,found,s,paths_per_s\n");
+	for(size = 1000; size <= max; size *= 10) {
+		route_trie_(&trie), errno = 0;
+		for(i = 0; i < size; i++) route_trie_add(&trie, route[i]);
+		if(errno) goto catch;
+		for(i = 0; i < PATHS; i++) {
+			char name[12];
+			orcish(name, sizeof name);
+			sprintf(path[i], "%s%s", i & 7 ? route[(size_t)rand() % size] : "",
+				name);
+		}
+		found = 0, t = now();
+		for(i = 0; i < PATHS; i++)
+			if(route_trie_longest_prefix(&trie, path[i])) found++;
+		row("longest_prefix", size, found, now() - t);
+		found = 0, t = now();
+		for(i = 0; i < PATHS; i++) {
+			strcpy(truncate, path[i]);
+			for(j = strlen(truncate); ; j--) {
+				truncate[j] = '\0';
+				if((x = route_trie_get(&trie, truncate)) || !j) break;
+			}
+			if(x) found++;
+		}
+		row("truncate", size, found, now() - t);
+		if(size > (size_t)-1 / 10) break;
+	}
+	route_trie_(&trie), free(route), free(path);
+	return EXIT_SUCCESS;
+catch:
+	perror("route");
+	route_trie_(&trie), free(route), free(path);
+	return EXIT_FAILURE;
+}
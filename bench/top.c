@@ -0,0 +1,117 @@
+/* Benchmarks autocomplete with `TRIE_SCORE`: the ten keys with the greatest
+ score that start with a prefix. <fn:<T>trie_top_k> goes best-first, against
+ going through every match with <fn:<T>trie_prefix> and sorting them by
+ score. For sizes that are powers of ten from 10^3 to the first argument,
+ (default 10^6,) it asks prefixes of one to three hexadecimal digits taken
+ from keys in the trie. Outputs comma-separated queries per second. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdlib.h> /* EXIT malloc free qsort strtoul */
+#include <stdio.h>  /* printf sprintf perror */
+#include <string.h> /* memcmp */
+#include <errno.h>  /* errno */
+#include <time.h>   /* clock_gettime */
+
+/* A key and it's popularity. */
+struct entry { char key[12]; double score; };
+static const char *entry_key(const struct entry *const e) { return e->key; }
+static double entry_score(const struct entry *const e) { return e->score; }
+
+#define TRIE_NAME top
+#define TRIE_VALUE struct entry
+#define TRIE_KEY &entry_key
+#define TRIE_SCORE &entry_score
+#include "../src/trie.h"
+
+/** @return Monotonic nanoseconds. */
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define K 10
+#define QUERIES 1000
+
+/** Orders by descending score. @implements qsort */
+static int by_score(const void *const a, const void *const b) {
+	const double x = (*(const struct entry *const *)a)->score,
+		y = (*(const struct entry *const *)b)->score;
+	return (x < y) - (x > y);
+}
+
+/** Asks `QUERIES` prefixes of `length` of `trie` of `size` from `pool` both
+ ways, with `matches` of room. @return Success. */
+static int run(const struct top_trie *const trie, const size_t size,
+	const struct entry *const pool, const size_t length,
+	struct entry **const matches) {
+	struct top_trie_iterator it;
+	struct entry *best[K], *x;
+	char prefix[QUERIES][4];
+	size_t q, n, total = 0, found = 0, i;
+	double t;
+	/* The same prefixes both ways. */
+	for(q = 0; q < QUERIES; q++) {
+		memcpy(prefix[q], pool[q * 7919 % size].key, length);
+		prefix[q][length] = '\0';
+	}
+	errno = 0, t = now();
+	for(q = 0; q < QUERIES; q++)
+		found += top_trie_top_k(trie, prefix[q], K, best);
+	if(errno) return 0;
+	t = now() - t;
+	printf("top_k,%lu,%lu,%lu,%.6f,%.0f\n", (unsigned long)size,
+		(unsigned long)length, (unsigned long)found, t / 1e9,
+		t > 0 ? QUERIES / t * 1e9 : 0.0);
+	t = now();
+	for(q = 0; q < QUERIES; q++) {
+		top_trie_prefix(trie, prefix[q], &it);
+		for(n = 0; x = top_trie_next(&it); n++) matches[n] = x;
+		qsort(matches, n, sizeof *matches, &by_score);
+		for(i = 0; i < n && i < K; i++) best[i] = matches[i];
+		total += i;
+	}
+	t = now() - t;
+	printf("sort,%lu,%lu,%lu,%.6f,%.0f\n", (unsigned long)size,
+		(unsigned long)length, (unsigned long)total, t / 1e9,
+		t > 0 ? QUERIES / t * 1e9 : 0.0);
+	if(total != found) return errno = EDOM, 0;
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	const size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	struct top_trie trie = TRIE_IDLE;
+	struct entry *pool = 0, **matches = 0;
+	unsigned long seed = 2463534242UL;
+	size_t size, i, length;
+	if(argc > 2 || !max) {
+		fprintf(stderr, "Usage: %s [maximum size, default 1000000]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(!(pool = malloc(sizeof *pool * max))
+		|| !(matches = malloc(sizeof *matches * max))) goto catch;
+	/* Unique keys in no order; popularity is skewed, like word frequency. */
+	for(i = 0; i < max; i++) {
+		sprintf(pool[i].key, "%08lx", (unsigned long)i * 2654435761UL
+			& 0xffffffffUL);
+		seed ^= seed << 13 & 0xffffffffUL, seed ^= seed >> 17,
+			seed ^= seed << 5 & 0xffffffffUL;
+		pool[i].score = 1.0 / (double)(seed % max + 1);
+	}
+	printf("method,size,prefix,results,s,queries_per_s\n");
+	for(size = 1000; size <= max; size *= 10) {
+		top_trie_(&trie), errno = 0;
+		for(i = 0; i < size; i++) top_trie_add(&trie, pool + i);
+		if(errno) goto catch;
+		for(length = 1; length <= 3; length++)
+			if(!run(&trie, size, pool, length, matches)) goto catch;
+		if(size > (size_t)-1 / 10) break;
+	}
+	top_trie_(&trie), free(pool), free(matches);
+	return EXIT_SUCCESS;
+catch:
+	perror("top");
+	top_trie_(&trie), free(pool), free(matches);
+	return EXIT_FAILURE;
+}
@@ -31,6 +31,48 @@
  @param[TRIE_TO_STRING]
  Defining this includes <to_string.h>, with the keys as the string.
 
+ @param[TRIE_METRICS]
+ Counts the work done in a <tag:trie_metrics> for every trie of this type,
+ read by <fn:<T>trie_metrics>. Otherwise, there is no code.
+
+ @param[TRIE_RECORD]
+ Allows every trie of this type to append a binary log of the calls to get,
+ add, put, remove, and prefix to a file with <fn:<T>trie_record>, for
+ replaying later. Otherwise, there is no code.
+
+ @param[TRIE_JOURNAL]
+ A set of strings, (no `TRIE_VALUE`,) can have a durable <tag:trie_journal>
+ attached to each trie with <fn:<T>trie_journal>. Successful adds, puts, and
+ removes append a record, in the same format as `TRIE_RECORD`, and every
+ `group` records are committed together. After a crash,
+ <fn:<T>trie_journal_replay> of the last <fn:<T>trie_checkpoint> and then the
+ journal since rebuilds it in bulk. A record that the crash cut short has to be
+ truncated from the journal before it's appended to again.
+
+ @param[TRIE_DUMP]
+ Writes a trie to a compact, sorted snapshot with <fn:<T>trie_dump>, and
+ loads it back with <fn:<T>trie_restore>. The keys are front-coded and the
+ values, if `TRIE_VALUE`, are copied as fixed-width bytes, so they must be
+ plain data that is it's own key, such as a `struct` with the key in an array.
+
+ @param[TRIE_BLOOM]
+ Each trie keeps a blocked Bloom filter of it's keys, so most lookups of keys
+ that are not there return before going down the trie. It costs about
+ `TRIE_BLOOM_BITS` bits per key, and adds and removes maintain it.
+
+ @param[TRIE_CACHE]
+ Each trie keeps a direct-mapped cache of this many, (a power of two,) recently
+ got values, by the hash of their key, in front of <fn:<T>trie_get>. A hit is
+ a hash and a `strcmp`. Removing or replacing values invalidates all of it.
+ <fn:<T>trie_get> writes the cache, even though the trie is `const`, so it's
+ not safe to get from more than one thread at once without a lock.
+
+ @param[TRIE_SCORE]
+ A function satisfying <typedef:<PT>score_fn>. Every tree keeps the greatest
+ score under it, so <fn:<T>trie_top_k> finds the best keys with a prefix
+ without going through all of them. Adds, puts, and removes maintain it; a
+ score that changes in place needs <fn:<T>trie_rescore>.
+
  @param[TRIE_TEST]
  Unit testing framework <fn:<T>trie_test>, included in a separate header,
  <../test/test_trie.h>. Must be defined equal to a (random) filler function,
@@ -49,6 +91,12 @@
 #if defined(TRIE_TEST) && !defined(TRIE_TO_STRING)
 #error TRIE_TEST requires TRIE_TO_STRING.
 #endif
+#if defined(TRIE_JOURNAL) && defined(TRIE_VALUE)
+#error TRIE_JOURNAL only stores keys, so it must not have TRIE_VALUE.
+#endif
+#if defined(TRIE_CACHE) && (TRIE_CACHE < 1 || (TRIE_CACHE) & (TRIE_CACHE) - 1)
+#error TRIE_CACHE must be a power of two.
+#endif
 
 #ifndef TRIE_H /* <!-- idempotent */
 #define TRIE_H
@@ -57,6 +105,9 @@
 #include <errno.h>
 #include <assert.h>
 #include <limits.h>
+#ifdef TRIE_RECORD
+#include <stdio.h>
+#endif
 /* <Kernighan and Ritchie, 1988, p. 231>. */
 #if defined(TRIE_CAT_) || defined(TRIE_CAT) || defined(T_) || defined(PT_) \
     || defined(TRIE_IDLE)
@@ -81,20 +132,286 @@
 #define TRIE_BRANCHES (TRIE_MAX_LEFT + 1) /* Maximum branches. */
 #define TRIE_ORDER (TRIE_BRANCHES + 1) /* Maximum branching factor/leaves. */
 struct trie_branch { unsigned char left, skip; };
+/* A `skip` this or more is escaped; the decision bit is found by sampling. */
+#define TRIE_SKIP_MAX UCHAR_MAX
+/* Set operations, <fn:<T>trie_union>, _etc_. */
+enum trie_set_op { TRIE_UNION, TRIE_INTERSECT, TRIE_DIFFERENCE };
+/* Which of the values with equal keys <fn:<T>trie_merge_next> gives: that of
+ the first trie, the last, or all of them in the order of the tries. */
+enum trie_merge_policy { TRIE_MERGE_FIRST, TRIE_MERGE_LAST, TRIE_MERGE_ALL };
+/* Forest depths past this are counted in the last, <tag:trie_stats>. */
+#define TRIE_STATS_DEPTH 32
+/* Trees past this deep are not remembered in a finger; they are found again
+ from the deepest that is. */
+#define TRIE_FINGER 32
+/** Shape of a trie filled by <fn:<T>trie_stats>. Trees with one leaf,
+ (empty followers when removing,) are `bsize[0]`; fill is `bsize[n]` for trees
+ of `n + 1` leaves out of `TRIE_ORDER`. */
+struct trie_stats {
+	size_t trees, keys, height, bytes;
+	double bytes_per_key;
+	size_t bsize[TRIE_ORDER], depth[TRIE_STATS_DEPTH], skip[UCHAR_MAX + 1];
+};
+/** Work done by every trie of a type that has `TRIE_METRICS`; see
+ <fn:<T>trie_metrics>. Trees visited and samples are divided by matches and
+ adds to get the average. This is static and unsynchronized. */
+struct trie_metrics { size_t matches, match_trees, adds, samples, splits,
+	restarts, collapses, frees, cache_hits, cache_misses; };
+/* One byte per operation in a log from `TRIE_RECORD`, followed by the
+ null-terminated key. */
+enum trie_record_op { TRIE_RECORD_GET = 'g', TRIE_RECORD_ADD = 'a',
+	TRIE_RECORD_PUT = 'p', TRIE_RECORD_REMOVE = 'r', TRIE_RECORD_PREFIX = 'x' };
 /* Dependency on `bmp.h`. */
 #define BMP_NAME trie
 #define BMP_BITS TRIE_ORDER
 #include "bmp.h"
-/** @return Whether `a` and `b` are equal up to the minimum of their lengths'.
- Used in <fn:<T>trie_prefix>. */
+/** @return The first bit where `a` and `b` differ, or `(size_t)-1` if they
+ are the same. */
+static size_t trie_mismatch(const char *const a, const char *const b) {
+	size_t byte = 0, bit;
+	while(a[byte] == b[byte]) if(a[byte++] == '\0') return (size_t)-1;
+	for(bit = byte * CHAR_BIT; !TRIE_DIFF(a, b, bit); bit++);
+	return bit;
+}
+/** @return `skip` as stored in a branch; too many bits are escaped. */
+static unsigned char trie_skip(const size_t skip)
+	{ return skip < TRIE_SKIP_MAX ? (unsigned char)skip : TRIE_SKIP_MAX; }
+/** @return Whether `a` is a prefix of `b`. Used in <fn:<T>trie_prefix>. */
 static int trie_is_prefix(const char *a, const char *b) {
 	for( ; ; a++, b++) {
 		if(*a == '\0') return 1;
-		if(*a != *b) return *b == '\0';
+		if(*a != *b) return 0;
+	}
+}
+/** `p` is a glob token other than `*` or the end. Sets `is_match` to whether
+ `c` matches it: `?` is any byte; `[...]` is a class of bytes and ranges,
+ `[!...]` or `[^...]` not; `\` escapes; anything else is itself.
+ @return The token after `p`. */
+static const char *trie_glob_token(const char *p, const unsigned char c,
+	int *const is_match) {
+	assert(p && *p != '*' && *p != '\0' && is_match);
+	if(*p == '?') return *is_match = 1, p + 1;
+	if(*p == '[') {
+		const char *a = p + 1;
+		int is_not = 0, is_in = 0;
+		if(*a == '!' || *a == '^') is_not = 1, a++;
+		do { /* The first can be `]`. */
+			unsigned char lo, hi;
+			if(*a == '\\' && a[1] != '\0') a++;
+			if(*a == '\0') break; /* Unclosed is literal. */
+			lo = hi = (unsigned char)*a++;
+			if(*a == '-' && a[1] != ']' && a[1] != '\0') {
+				if(*++a == '\\' && a[1] != '\0') a++;
+				hi = (unsigned char)*a++;
+			}
+			is_in |= lo <= c && c <= hi;
+		} while(*a != ']' && *a != '\0');
+		if(*a == ']') return *is_match = is_in != is_not, a + 1;
+	} else if(*p == '\\' && p[1] != '\0') {
+		p++;
+	}
+	return *is_match = (unsigned char)*p == c, p + 1;
+}
+/** Bytes `[from, to)` of `s` are the start of every key in a sub-tree.
+ @return Whether the glob `p` could match any of them, as far as it goes
+ before the first `*`. */
+static int trie_glob_prefix(const char *p, const char *const s,
+	const size_t from, const size_t to) {
+	size_t i;
+	int is_match = 1;
+	for(i = 0; i < to; i++) {
+		if(*p == '*') return 1;
+		if(*p == '\0') return 0; /* The keys are longer. */
+		p = trie_glob_token(p, (unsigned char)s[i], &is_match);
+		if(i >= from && !is_match) return 0;
+	}
+	return 1;
+}
+/** @return Whether all of `s` matches the glob `p`. On a mismatch, the last
+ `*` takes one more byte, so it's \O(|`p`| |`s`|). */
+static int trie_glob_match(const char *p, const char *s) {
+	const char *star = 0, *star_s = 0;
+	int is_match;
+	for( ; ; ) {
+		if(*p == '*') { star = ++p, star_s = s; continue; }
+		if(*s == '\0') { while(*p == '*') p++; if(*p == '\0') return 1; }
+		else if(*p != '\0') {
+			const char *const next = trie_glob_token(p, (unsigned char)*s,
+				&is_match);
+			if(is_match) { p = next, s++; continue; }
+		}
+		if(!star || *star_s == '\0') return 0;
+		p = star, s = ++star_s;
 	}
 }
+/** Bytes `[from, known)` of `key` are being looked at for the end of it's
+ group, which is through the first `delim`, or `depth` bytes.
+ @return The length of the group, or `(size_t)-1` if it's past `known`. */
+static size_t trie_group_length(const char *const key, size_t from,
+	const size_t known, const size_t depth, const char delim) {
+	for( ; from < known && from < depth; from++)
+		if(delim && key[from] == delim) return from + 1;
+	return depth <= known ? depth : (size_t)-1;
+}
 #endif /* idempotent --> */
 
+#if defined(TRIE_BLOOM) && !defined(TRIE_BLOOM_H) /* <!-- bloom */
+#define TRIE_BLOOM_H
+/** <http://www.isthe.com/chongo/tech/comp/fnv/> FNV-1a.
+ @return The 32-bit hash of `a`. */
+static unsigned long trie_hash(const char *a) {
+	unsigned long h = 2166136261UL;
+	while(*a) h = (h ^ (unsigned char)*a++) * 16777619UL & 0xffffffffUL;
+	return h;
+}
+/* A blocked Bloom filter for `TRIE_BLOOM`, <Putze, Sanders, Singler, 2007
+ Cache>: each key sets `TRIE_BLOOM_HASHES` bits in one block of
+ `TRIE_BLOOM_BLOCK` bits, (a cache line,) chosen by it's hash. */
+#define TRIE_BLOOM_BITS 10
+#define TRIE_BLOOM_HASHES 7
+#define TRIE_BLOOM_BLOCK 512
+#define TRIE_BLOOM_WORD (sizeof(unsigned) * CHAR_BIT)
+/* Removing doesn't clear bits; it's rebuilt when `stale` or full. */
+struct trie_bloom { size_t blocks, capacity, size, stale; unsigned *word; };
+/** @return A new empty filter of `blocks` or null. @throws[malloc] */
+static struct trie_bloom *trie_bloom(const size_t blocks) {
+	const size_t words = blocks * (TRIE_BLOOM_BLOCK / TRIE_BLOOM_WORD);
+	struct trie_bloom *bloom;
+	assert(blocks);
+	if(!(bloom = malloc(sizeof *bloom + sizeof *bloom->word * words)))
+		return 0;
+	bloom->blocks = blocks;
+	bloom->capacity = blocks * TRIE_BLOOM_BLOCK / TRIE_BLOOM_BITS;
+	bloom->size = bloom->stale = 0;
+	bloom->word = (unsigned *)(void *)(bloom + 1);
+	memset(bloom->word, 0, sizeof *bloom->word * words);
+	return bloom;
+}
+/** Sets the bits of `key` in `bloom`, or, if `is_query`, only reads them, so
+ that lookups don't write to a shared filter.
+ @return Whether they were all set. */
+static int trie_bloom_bits(struct trie_bloom *const bloom,
+	const char *const key, const int is_query) {
+	unsigned long h = trie_hash(key), step;
+	unsigned *const block = bloom->word
+		+ h % bloom->blocks * (TRIE_BLOOM_BLOCK / TRIE_BLOOM_WORD);
+	unsigned i;
+	int is_all = 1;
+	/* The block used the low bits; mix for the bits in the block. */
+	h = (h ^ h >> 16) * 0x45d9f3bUL & 0xffffffffUL, h ^= h >> 16;
+	for(step = h >> 9 | 1, i = 0; i < TRIE_BLOOM_HASHES; i++, h += step) {
+		const unsigned bit = (unsigned)(h % TRIE_BLOOM_BLOCK),
+			mask = 1u << bit % TRIE_BLOOM_WORD;
+		unsigned *const word = block + bit / TRIE_BLOOM_WORD;
+		if(is_query) { if(!(*word & mask)) return 0; continue; }
+		if(!(*word & mask)) *word |= mask, is_all = 0;
+	}
+	return is_all;
+}
+#endif /* bloom --> */
+
+#if defined(TRIE_JOURNAL) && !defined(TRIE_JOURNAL_H) /* <!-- journal */
+#define TRIE_JOURNAL_H
+#include <stdio.h>
+/** Makes the journal durable, such as `fsync` of `fileno(fp)`.
+ @return Success. */
+typedef int (*trie_sync_fn)(FILE *fp);
+/** A write-ahead log of the changes to a trie with `TRIE_JOURNAL`, in the
+ format of `TRIE_RECORD`. A record is buffered until `group` are pending, then
+ they are flushed and synced together, (group commit.) A crash loses at most
+ the pending records, which were in memory only. `error` is the `errno` of
+ the first failure, or zero. */
+struct trie_journal { FILE *fp; trie_sync_fn sync; size_t group, pending;
+	int error; };
+/** Initializes `journal` to append to `fp`, committing every `group`, (at
+ least one,) records with `sync`, which may be null to only flush. */
+static void trie_journal(struct trie_journal *const journal, FILE *const fp,
+	const size_t group, const trie_sync_fn sync) {
+	assert(journal && fp);
+	journal->fp = fp, journal->sync = sync;
+	journal->group = group ? group : 1, journal->pending = 0;
+	journal->error = 0;
+}
+/** Flushes and syncs the pending records of `journal`.
+ @return Whether every record so far is durable. @throws[fflush, sync] */
+static int trie_journal_commit(struct trie_journal *const journal) {
+	assert(journal);
+	journal->pending = 0;
+	if(journal->error) return 0;
+	if(fflush(journal->fp) == EOF || journal->sync
+		&& !journal->sync(journal->fp)) journal->error = errno ? errno : EIO;
+	return !journal->error;
+}
+/** Appends `op` on `key` to `journal`, committing if it fills a group. */
+static void trie_journal_append(struct trie_journal *const journal,
+	const enum trie_record_op op, const char *const key) {
+	assert(journal && key);
+	if(fputc(op, journal->fp) == EOF || fputs(key, journal->fp) == EOF
+		|| fputc('\0', journal->fp) == EOF)
+		{ if(!journal->error) journal->error = errno ? errno : EIO; }
+	if(++journal->pending >= journal->group) trie_journal_commit(journal);
+}
+/** Orders records by key, then by their place in the journal, for
+ <fn:<T>trie_journal_replay>. */
+static int trie_journal_compare(const void *const a, const void *const b) {
+	const char *const x = *(const char *const *)a,
+		*const y = *(const char *const *)b;
+	const int cmp = strcmp(x + 1, y + 1);
+	return cmp ? cmp : (x > y) - (x < y);
+}
+#endif /* journal --> */
+
+#if defined(TRIE_DUMP) && !defined(TRIE_DUMP_H) /* <!-- dump */
+#define TRIE_DUMP_H
+#include <stdio.h>
+/* A snapshot from <fn:<T>trie_dump> is a header, blocks of
+ `TRIE_DUMP_BLOCK` keys in order, an index of the offset of each block, and
+ a trailer. The first key of a block is whole; the rest are front-coded as
+ the length they share with the key before, (a varint,) and the remaining
+ suffix, <Witten, Moffat, Bell, 1999, Managing>. The values of a block follow
+ it's keys. The header is `"trie"`, the version, the block size, two zeros,
+ and the width of a value; the trailer is the number of keys, their bytes,
+ the longest key, and the offset of the index. Numbers are 8-byte big-endian.
+ */
+#define TRIE_DUMP_BLOCK 16
+#define TRIE_DUMP_VERSION 1
+#define TRIE_DUMP_HEADER 16
+#define TRIE_DUMP_TRAILER 32
+/** Writes `n` to `fp` as a big-endian number. */
+static void trie_dump_number(FILE *const fp, const size_t n) {
+	unsigned i;
+	for(i = 8; i; i--) fputc(i > sizeof n ? 0 : (int)(n >> (i - 1) * 8 & 255),
+		fp);
+}
+/** @return The number at `a`. */
+static size_t trie_dump_read(const unsigned char *const a) {
+	size_t n = 0;
+	unsigned i;
+	for(i = 0; i < 8; i++) n = n << 4 << 4 | a[i];
+	return n;
+}
+/** Writes `n` to `fp` as a varint of 7 bits per byte.
+ @return The bytes written. */
+static size_t trie_dump_varint(FILE *const fp, size_t n) {
+	size_t bytes = 1;
+	for( ; n > 127; n >>= 7, bytes++) fputc((int)(n & 127 | 128), fp);
+	fputc((int)n, fp);
+	return bytes;
+}
+/** @return The number at `*a`, which is advanced, but not past `end`. */
+static size_t trie_dump_unvarint(const unsigned char **const a,
+	const unsigned char *const end) {
+	size_t n = 0;
+	unsigned shift = 0;
+	while(*a < end && shift < sizeof n * CHAR_BIT) {
+		const unsigned c = *(*a)++;
+		n |= (size_t)(c & 127) << shift, shift += 7;
+		if(!(c & 128)) break;
+	}
+	return n;
+}
+#endif /* dump --> */
+
 #ifndef TRIE_VALUE /* <!-- !type */
 #define TRIE_SET /* Testing purposes; `const char *` is not really testable. */
 /** Default `char` uses `a` as the key, which makes it a set of strings. */
@@ -117,13 +434,33 @@ struct PT_(tree) {
 	struct trie_branch branch[TRIE_BRANCHES];
 	struct trie_bmp is_child;
 	union PT_(leaf) leaf[TRIE_ORDER];
+#ifdef TRIE_SCORE
+	double max; /* The greatest score of it and it's children. */
+#endif
 };
 
+#ifdef TRIE_CACHE /* <!-- cache */
+/* A slot is only good if it's from the current `generation`. */
+struct PT_(cache) { size_t generation;
+	struct { PT_(type) *data; size_t generation; } slot[TRIE_CACHE]; };
+#endif /* cache --> */
+
 /** To initialize it to an idle state, see <fn:<T>trie>, `TRIE_IDLE`, `{0}`
  (`C99`), or being `static`.
 
  ![States.](../web/states.png) */
-struct T_(trie) { struct PT_(tree) *root; };
+struct T_(trie) {
+	struct PT_(tree) *root;
+#ifdef TRIE_BLOOM
+	struct trie_bloom *bloom;
+#endif
+#ifdef TRIE_CACHE
+	struct PT_(cache) *cache;
+#endif
+#ifdef TRIE_JOURNAL
+	struct trie_journal *journal;
+#endif
+};
 #ifndef TRIE_IDLE /* <!-- !zero */
 #define TRIE_IDLE { 0 }
 #endif /* !zero --> */
@@ -134,13 +471,69 @@ struct T_(trie) { struct PT_(tree) *root; };
 struct PT_(iterator)
 	{ struct PT_(tree) *root, *next; unsigned leaf, unused; };
 
-/** Stores a range in the trie. Any changes in the topology of the trie
- invalidate it. @fixme Replacing `root` with `bit` would make it faster and
- allow size remaining; just have to fiddle with `end` to `above`. That makes it
- incompatible with private, but could merge. */
+/** Stores a range in the trie, `[leaf_begin, leaf_end)` of the tree `end`, and
+ a cursor, `leaf` of `next`, that goes between the elements in both
+ directions. Any changes in the topology of the trie invalidate it.
+ @fixme Replacing `root` with `bit` would make it faster; just have to fiddle
+ with `end` to `above`. That makes it incompatible with private, but could
+ merge. */
 struct T_(trie_iterator);
-struct T_(trie_iterator)
-	{ struct PT_(tree) *root, *next, *end; unsigned leaf, leaf_end; };
+struct T_(trie_iterator) { struct PT_(tree) *root, *next, *end;
+	unsigned leaf, leaf_begin, leaf_end; };
+
+/** Stores a glob `pattern` of <fn:<T>trie_glob> and the value it last
+ returned. It doesn't allocate, so it can be dropped at any time, but any
+ changes in the topology of the trie invalidate it. */
+struct T_(trie_glob);
+struct T_(trie_glob) { struct PT_(tree) *root; const char *pattern;
+	size_t literal; PT_(type) *last; };
+
+/* A trie in a merge; the loser of node `i` of the tournament is in `i`. */
+struct PT_(merge_source) { struct T_(trie_iterator) it; PT_(type) *head;
+	size_t loser; };
+/** Stores a merge of many tries from <fn:<T>trie_merge>. It holds an iterator
+ of each, so any changes in the topology of them invalidate it. */
+struct T_(trie_merge);
+struct T_(trie_merge) { struct PT_(merge_source) *source; size_t size;
+	const char *to; enum trie_merge_policy policy; };
+
+/* A tree on the path of a key, starting at `bit`, having checked `key` is
+ not shorter than `byte`. Adding also keeps the backtracking of the trees
+ above: the last `full` of them are full, under `anchor`, entered at
+ `anchor_bit`, which is not. */
+struct PT_(step) { struct PT_(tree) *tr, *anchor;
+	size_t bit, byte, anchor_bit, full; };
+/* The path down the forest of the last `key`. Keys in order share most of
+ it with the one before, so they can start from the deepest tree that they
+ share, <Guibas, McCreight, Plass, Roberts, 1977, Finger>. */
+struct PT_(finger) { const char *key; unsigned depth;
+	struct PT_(step) path[TRIE_FINGER]; };
+
+/** Remembers where the last key went in <fn:<T>trie_hint_add>, so the next,
+ if it's close in order, such as timestamps or increasing identifiers, starts
+ from there instead of the root. It is valid until a topological change to
+ the trie that is not through it. */
+struct T_(trie_hint) { struct PT_(finger) get, add; };
+
+#ifdef TRIE_METRICS /* <!-- metrics */
+static struct trie_metrics PT_(metrics);
+#define TRIE_COUNT(n) (PT_(metrics).n++)
+#else /* metrics --><!-- !metrics */
+#define TRIE_COUNT(n) (void)0
+#endif /* !metrics --> */
+
+#ifdef TRIE_RECORD /* <!-- record */
+static FILE *PT_(record_fp);
+/** Appends `op` on `key` to the log. */
+static void PT_(record)(const enum trie_record_op op, const char *const key) {
+	fputc(op, PT_(record_fp)), fputs(key, PT_(record_fp));
+	fputc('\0', PT_(record_fp));
+}
+#define TRIE_RECORD_OP(op, key) \
+	(PT_(record_fp) ? PT_(record)(op, key) : (void)0)
+#else /* record --><!-- !record */
+#define TRIE_RECORD_OP(op, key) (void)0
+#endif /* !record --> */
 
 /** Responsible for picking out the null-terminated string. Modifying the
  string key in the original <typedef:<PT>type> while in any trie causes the
@@ -150,21 +543,319 @@ typedef const char *(*PT_(key_fn))(const PT_(type) *);
 /* Check that `TRIE_KEY` is a function satisfying <typedef:<PT>key_fn>. */
 static PT_(key_fn) PT_(to_key) = (TRIE_KEY);
 
+#ifdef TRIE_SCORE /* <!-- score */
+/** Ranks a datum for <fn:<T>trie_top_k>, such as it's popularity. It must
+ not change while in the trie, except through <fn:<T>trie_rescore>. */
+typedef double (*PT_(score_fn))(const PT_(type) *);
+/* Check that `TRIE_SCORE` is a function satisfying <typedef:<PT>score_fn>. */
+static PT_(score_fn) PT_(score) = (TRIE_SCORE);
+#endif /* score --> */
+
+#ifdef TRIE_JOURNAL /* <!-- journal */
+/** Appends `op` on `x` to the journal of `trie`, if it has one, and `is`.
+ @return `is`. */
+static int PT_(journal)(const struct T_(trie) *const trie, const int is,
+	const enum trie_record_op op, PT_(type) *const x) {
+	if(is && trie->journal)
+		trie_journal_append(trie->journal, op, PT_(to_key)(x));
+	return is;
+}
+/** Appends a remove of `x`, if it's not null, to the journal of `trie`.
+ @return `x`. */
+static PT_(type) *PT_(journal_remove)(const struct T_(trie) *const trie,
+	PT_(type) *const x)
+	{ return PT_(journal)(trie, !!x, TRIE_RECORD_REMOVE, x), x; }
+/** Appends `op` on every key starting with `prefix` in `trie`. */
+static void PT_(journal_prefix)(const struct T_(trie) *const trie,
+	const char *const prefix, const enum trie_record_op op);
+#define TRIE_JOURNAL_IS(trie, is, op, x) PT_(journal)(trie, is, op, x)
+#define TRIE_JOURNAL_REMOVE(trie, x) PT_(journal_remove)(trie, x)
+#define TRIE_JOURNAL_PREFIX(trie, prefix, op) \
+	((trie)->journal ? PT_(journal_prefix)(trie, prefix, op) : (void)0)
+#else /* journal --><!-- !journal */
+#define TRIE_JOURNAL_IS(trie, is, op, x) (is)
+#define TRIE_JOURNAL_REMOVE(trie, x) (x)
+#define TRIE_JOURNAL_PREFIX(trie, prefix, op) (void)0
+#endif /* !journal --> */
+
+#ifdef TRIE_BLOOM /* <!-- bloom */
+
+/** Adds every key in `tree` to `bloom`, if not null. @return How many. */
+static size_t PT_(bloom_tree)(struct trie_bloom *const bloom,
+	const struct PT_(tree) *const tree) {
+	size_t size = 0;
+	unsigned i;
+	for(i = 0; i <= tree->bsize; i++) {
+		if(trie_bmp_test(&tree->is_child, i))
+			{ size += PT_(bloom_tree)(bloom, tree->leaf[i].child); continue; }
+		if(bloom) trie_bloom_bits(bloom, PT_(to_key)(tree->leaf[i].data), 0);
+		size++;
+	}
+	return size;
+}
+
+/** Replaces the filter of `trie` with one that has room for twice it's keys.
+ If that can't be allocated, `trie` is unfiltered until it is empty, but that
+ is not an error. */
+static void PT_(bloom_build)(struct T_(trie) *const trie) {
+	const int errno_ = errno;
+	const size_t size = trie->root ? PT_(bloom_tree)(0, trie->root) : 0;
+	free(trie->bloom);
+	if(trie->bloom = trie_bloom(2 * size * TRIE_BLOOM_BITS
+		/ TRIE_BLOOM_BLOCK + 1)) {
+		if(trie->root) PT_(bloom_tree)(trie->bloom, trie->root);
+		trie->bloom->size = size;
+	}
+	errno = errno_;
+}
+
+/** Adds `key` to the filter of `trie` after it has been added. It's rebuilt
+ if it's the first key, or the filter is full or stale; that counts `key`. */
+static void PT_(bloom_add)(struct T_(trie) *const trie,
+	const char *const key) {
+	struct trie_bloom *const b = trie->bloom;
+	assert(trie->root);
+	if(b && b->size < b->capacity && b->stale <= b->capacity / 2)
+		trie_bloom_bits(b, key, 0), b->size++;
+	else if(b || !trie->root->bsize
+		&& !trie_bmp_test(&trie->root->is_child, 0))
+		PT_(bloom_build)(trie);
+}
+
+/** `trie` has split into `right`, which gets a copy of the filter. Both are
+ rebuilt the next time they are added to. */
+static void PT_(bloom_split)(struct T_(trie) *const trie,
+	struct T_(trie) *const right) {
+	const int errno_ = errno;
+	free(right->bloom), right->bloom = 0;
+	if(!trie->bloom) return;
+	trie->bloom->stale = trie->bloom->capacity;
+	if(!(right->bloom = trie_bloom(trie->bloom->blocks)))
+		{ errno = errno_; return; }
+	memcpy(right->bloom->word, trie->bloom->word, sizeof *right->bloom->word
+		* trie->bloom->blocks * (TRIE_BLOOM_BLOCK / TRIE_BLOOM_WORD));
+	right->bloom->size = trie->bloom->size;
+	right->bloom->stale = right->bloom->capacity;
+}
+
+/** `right` has joined `left`; the filters are combined, if they are the
+ same size, or `left` is rebuilt. */
+static void PT_(bloom_join)(struct T_(trie) *const left,
+	struct T_(trie) *const right) {
+	struct trie_bloom *const l = left->bloom, *const r = right->bloom;
+	if(l && r && l->blocks == r->blocks) {
+		size_t i;
+		for(i = 0; i < l->blocks * (TRIE_BLOOM_BLOCK / TRIE_BLOOM_WORD); i++)
+			l->word[i] |= r->word[i];
+		l->size += r->size, l->stale += r->stale;
+	} else if(l) {
+		PT_(bloom_build)(left);
+	}
+	free(r), right->bloom = 0;
+}
+
+#define TRIE_BLOOM_NO(trie, key) \
+	((trie)->bloom && !trie_bloom_bits((trie)->bloom, key, 1))
+#define TRIE_BLOOM_ADD(trie, key) PT_(bloom_add)(trie, key)
+#define TRIE_BLOOM_REMOVE(trie) \
+	((trie)->bloom ? (void)((trie)->bloom->size--, (trie)->bloom->stale++) \
+	: (void)0)
+#define TRIE_BLOOM_STALE(trie) \
+	((trie)->bloom ? (void)((trie)->bloom->stale = (trie)->bloom->capacity) \
+	: (void)0)
+#define TRIE_BLOOM_SPLIT(trie, right) PT_(bloom_split)(trie, right)
+#define TRIE_BLOOM_JOIN(left, right) PT_(bloom_join)(left, right)
+#define TRIE_BLOOM_BYTES(trie) ((trie)->bloom ? sizeof *(trie)->bloom \
+	+ (trie)->bloom->blocks * (TRIE_BLOOM_BLOCK / CHAR_BIT) : 0)
+
+#else /* bloom --><!-- !bloom */
+
+#define TRIE_BLOOM_NO(trie, key) 0
+#define TRIE_BLOOM_ADD(trie, key) (void)0
+#define TRIE_BLOOM_REMOVE(trie) (void)0
+#define TRIE_BLOOM_STALE(trie) (void)0
+#define TRIE_BLOOM_SPLIT(trie, right) (void)0
+#define TRIE_BLOOM_JOIN(left, right) (void)0
+#define TRIE_BLOOM_BYTES(trie) 0
+
+#endif /* !bloom --> */
+
+/** @return The leftmost datum of leaf `lf` of `tree`. */
+static PT_(type) *PT_(leftmost)(const struct PT_(tree) *tree, unsigned lf) {
+	assert(tree);
+	while(trie_bmp_test(&tree->is_child, lf))
+		tree = tree->leaf[lf].child, lf = 0;
+	return tree->leaf[lf].data;
+}
+
+/** @return The rightmost datum of `tree`. */
+static PT_(type) *PT_(rightmost)(const struct PT_(tree) *tree) {
+	assert(tree);
+	while(trie_bmp_test(&tree->is_child, tree->bsize))
+		tree = tree->leaf[tree->bsize].child;
+	return tree->leaf[tree->bsize].data;
+}
+
+/** @return The leftmost key `lf` of `any`. */
+static const char *PT_(sample)(const struct PT_(tree) *tree,
+	unsigned lf) { return PT_(to_key)(PT_(leftmost)(tree, lf)); }
+
+/** A `skip` of `TRIE_SKIP_MAX` is escaped: the decision bit of the branch is
+ where the keys on it's left and right first differ; any two will do, so it
+ takes the leftmost of each. @return The decision bit of branch `br` of
+ `tree`, whose leftmost leaf is `lf`, starting from `bit`. @order \O(`bit`) */
+static size_t PT_(decision)(const struct PT_(tree) *const tree,
+	const unsigned br, const unsigned lf, const size_t bit) {
+	const struct trie_branch *const branch = tree->branch + br;
+	size_t d;
+	if(branch->skip != TRIE_SKIP_MAX) return bit + branch->skip;
+	d = trie_mismatch(PT_(sample)(tree, lf),
+		PT_(sample)(tree, lf + branch->left + 1));
+	assert(d != (size_t)-1 && d >= bit + TRIE_SKIP_MAX);
+	return d;
+}
+
+#ifdef TRIE_SCORE /* <!-- score */
+
+/** @return The greatest score under leaf `lf` of `tree`. */
+static double PT_(leaf_max)(const struct PT_(tree) *const tree,
+	const unsigned lf) {
+	return trie_bmp_test(&tree->is_child, lf) ? tree->leaf[lf].child->max
+		: PT_(score)(tree->leaf[lf].data);
+}
+
+/** @return The greatest score of the leaves of `tree`, whose children are
+ up-to-date. @order \O(`TRIE_ORDER`) */
+static double PT_(tree_max)(const struct PT_(tree) *const tree) {
+	double max = PT_(leaf_max)(tree, 0), m;
+	unsigned lf;
+	for(lf = 1; lf <= tree->bsize; lf++)
+		if(max < (m = PT_(leaf_max)(tree, lf))) max = m;
+	return max;
+}
+
+/** Updates the trees on the path of `key` in `tree`, of `key_bits`, starting
+ at `bit`, from the bottom. If `old` is null, all of them are found again;
+ otherwise, a datum on the path that was `*old` changed, so only those trees
+ that had it as the greatest are. @return The greatest score of `tree`. */
+static double PT_(score_path)(struct PT_(tree) *const tree,
+	const char *const key, const size_t key_bits, size_t bit,
+	const double *const old) {
+	struct { unsigned br0, br1, lf; } t;
+	double max;
+	assert(tree && key);
+	t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+	while(t.br0 < t.br1) {
+		const struct trie_branch *const branch = tree->branch + t.br0;
+		bit = PT_(decision)(tree, t.br0, t.lf, bit);
+		if(bit >= key_bits || !TRIE_QUERY(key, bit))
+			t.br1 = ++t.br0 + branch->left;
+		else
+			t.br0 += branch->left + 1, t.lf += branch->left + 1;
+		bit++;
+	}
+	max = trie_bmp_test(&tree->is_child, t.lf) ? PT_(score_path)(
+		tree->leaf[t.lf].child, key, key_bits, bit, old)
+		: PT_(score)(tree->leaf[t.lf].data);
+	if(!old || tree->max <= *old) tree->max = PT_(tree_max)(tree);
+	else if(tree->max < max) tree->max = max;
+	return tree->max;
+}
+
+/** The path of `key` in `trie` has changed, where `old`, if not null, is the
+ score of the only datum that did. */
+static void PT_(score_key)(struct T_(trie) *const trie,
+	const char *const key, const double *const old) {
+	assert(trie && key);
+	if(trie->root) PT_(score_path)(trie->root, key,
+		(strlen(key) + 1) * CHAR_BIT, 0, old);
+}
+
+/** `x` has replaced `was`, which may be the same, in `trie`, or was added or
+ removed. */
+static void PT_(score_change)(struct T_(trie) *const trie,
+	const PT_(type) *const x, const PT_(type) *const was) {
+	const double old = PT_(score)(was);
+	PT_(score_key)(trie, PT_(to_key)(x), &old);
+}
+
+/** The extreme edge of `trie`, the right if `is_right`, has new trees. */
+static void PT_(score_edge)(struct T_(trie) *const trie, const int is_right) {
+	assert(trie);
+	if(trie->root) PT_(score_key)(trie, PT_(to_key)(is_right
+		? PT_(rightmost)(trie->root) : PT_(leftmost)(trie->root, 0)), 0);
+}
+
+#define TRIE_SCORE_TREE(tree) (void)((tree)->max = PT_(tree_max)(tree))
+#define TRIE_SCORE_CHANGE(trie, x, was) PT_(score_change)(trie, x, was)
+#define TRIE_SCORE_KEY(trie, key) PT_(score_key)(trie, key, 0)
+#define TRIE_SCORE_EDGE(trie, is_right) PT_(score_edge)(trie, is_right)
+
+#else /* score --><!-- !score */
+
+#define TRIE_SCORE_TREE(tree) (void)0
+#define TRIE_SCORE_CHANGE(trie, x, was) (void)0
+#define TRIE_SCORE_KEY(trie, key) (void)0
+#define TRIE_SCORE_EDGE(trie, is_right) (void)0
+
+#endif /* !score --> */
+
+/** `key` is next on `finger`; forgets the trees that it doesn't go through
+ the same as the last key. @return The deepest tree that it does, which is
+ forgotten, too, or null if it starts at the root. */
+static const struct PT_(step) *PT_(finger_start)(
+	struct PT_(finger) *const finger, const char *const key) {
+	size_t bit;
+	unsigned d;
+	assert(finger && key);
+	if(!finger->key || !finger->depth) { finger->depth = 0; return 0; }
+	/* A tree's path is decided by the bits before it. */
+	bit = trie_mismatch(finger->key, key);
+	for(d = finger->depth - 1; d && bit < finger->path[d].bit; d--);
+	return finger->path + (finger->depth = d);
+}
+
+/** Adds `tree`, starting at `bit`, having checked `byte`, to `finger`. It's
+ below `full` full trees, under `anchor` at `anchor_bit`, which is not. */
+static void PT_(finger_push)(struct PT_(finger) *const finger,
+	struct PT_(tree) *const tree, const size_t bit, const size_t byte,
+	const size_t full, struct PT_(tree) *const anchor,
+	const size_t anchor_bit) {
+	struct PT_(step) *step;
+	assert(finger && tree);
+	if(finger->depth >= TRIE_FINGER) return;
+	step = finger->path + finger->depth++;
+	step->tr = tree, step->bit = bit, step->byte = byte;
+	step->full = full, step->anchor = anchor, step->anchor_bit = anchor_bit;
+}
+
 /** @return The address of a index candidate match for `key` in `trie`, or
- null, if `key` is definitely not in `trie`. @order \O(|`key`|) */
+ null, if `key` is definitely not in `trie`.
+ @param[finger] If not-null, starts where the last key left off, and
+ remembers the path. @order \O(|`key`|) */
 static PT_(type) **PT_(leaf_match)(const struct T_(trie) *const trie,
-	const char *const key) {
+	const char *const key, struct PT_(finger) *const finger) {
 	struct PT_(tree) *tree;
 	size_t bit; /* `bit \in key`.  */
 	struct { unsigned br0, br1, lf; } t;
 	struct { size_t cur, next; } byte; /* `key` null checks. */
 	assert(trie && key);
 	if(!(tree = trie->root)) return 0; /* Empty. */
-	for(byte.cur = 0, bit = 0; ; ) { /* Forest. */
+	TRIE_COUNT(matches);
+	byte.cur = 0, bit = 0;
+	if(finger) {
+		const struct PT_(step) *const step = PT_(finger_start)(finger, key);
+		if(step) tree = step->tr, bit = step->bit, byte.cur = step->byte;
+		finger->key = key;
+	}
+	for( ; ; ) { /* Forest. */
+		TRIE_COUNT(match_trees);
+		if(finger) PT_(finger_push)(finger, tree, bit, byte.cur, 0, 0, 0);
 		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
 		while(t.br0 < t.br1) { /* Tree. */
 			const struct trie_branch *const branch = tree->branch + t.br0;
-			for(byte.next = (bit += branch->skip) / CHAR_BIT;
+			bit = PT_(decision)(tree, t.br0, t.lf, bit);
+			for(byte.next = bit / CHAR_BIT;
 				byte.cur < byte.next; byte.cur++)
 				if(key[byte.cur] == '\0') return 0; /* Too short. */
 			if(!TRIE_QUERY(key, bit))
@@ -182,12 +873,12 @@ static PT_(type) **PT_(leaf_match)(const struct T_(trie) *const trie,
 /** @return An index candidate match for `key` in `trie`. */
 static PT_(type) *PT_(match)(const struct T_(trie) *const trie,
 	const char *const key)
-	{ PT_(type) **const x = PT_(leaf_match)(trie, key); return x ? *x : 0; }
+	{ PT_(type) **const x = PT_(leaf_match)(trie, key, 0); return x ? *x : 0; }
 
 /** @return The address of the exact match for `key` in `trie` or null. */
 static PT_(type) **PT_(leaf_get)(const struct T_(trie) *const trie,
 	const char *const key) {
-	PT_(type) **const x = PT_(leaf_match)(trie, key);
+	PT_(type) **const x = PT_(leaf_match)(trie, key, 0);
 	return x && !strcmp(PT_(to_key)(*x), key) ? x : 0;
 }
 
@@ -198,6 +889,62 @@ static PT_(type) *PT_(get)(const struct T_(trie) *const trie,
 	return x && !strcmp(PT_(to_key)(x), key) ? x : 0;
 }
 
+#ifdef TRIE_CACHE /* <!-- cache */
+
+/** Gives `trie` a cache if it doesn't have one. If it can't be allocated,
+ that's not an error; it tries again on the next add. */
+static void PT_(cache_add)(struct T_(trie) *const trie) {
+	const int errno_ = errno;
+	if(trie->cache || !(trie->cache = malloc(sizeof *trie->cache)))
+		{ errno = errno_; return; }
+	memset(trie->cache, 0, sizeof *trie->cache);
+	trie->cache->generation = 1;
+}
+
+/** @return Exact match for `key` in `trie` or null. The cache is looked at
+ first, and the value is remembered after. */
+static PT_(type) *PT_(cache_get)(const struct T_(trie) *const trie,
+	const char *const key) {
+	struct PT_(cache) *const cache = trie->cache;
+	PT_(type) *x;
+	unsigned long h;
+	if(!cache) return TRIE_BLOOM_NO(trie, key) ? 0 : PT_(get)(trie, key);
+	h = trie_hash(key) & (TRIE_CACHE - 1);
+	if(cache->slot[h].generation == cache->generation
+		&& !strcmp(PT_(to_key)(x = cache->slot[h].data), key))
+		return TRIE_COUNT(cache_hits), x;
+	TRIE_COUNT(cache_misses);
+	if(x = TRIE_BLOOM_NO(trie, key) ? 0 : PT_(get)(trie, key))
+		cache->slot[h].data = x, cache->slot[h].generation = cache->generation;
+	return x;
+}
+
+/** `right` has joined `left`; what's in either cache is still in `left`. */
+static void PT_(cache_join)(struct T_(trie) *const left,
+	struct T_(trie) *const right) {
+	if(!left->cache) left->cache = right->cache;
+	else free(right->cache);
+	right->cache = 0;
+}
+
+#define TRIE_CACHE_GET(trie, key) PT_(cache_get)(trie, key)
+#define TRIE_CACHE_ADD(trie) PT_(cache_add)(trie)
+#define TRIE_CACHE_STALE(trie) \
+	((trie)->cache ? (void)(trie)->cache->generation++ : (void)0)
+#define TRIE_CACHE_JOIN(left, right) PT_(cache_join)(left, right)
+#define TRIE_CACHE_BYTES(trie) ((trie)->cache ? sizeof *(trie)->cache : 0)
+
+#else /* cache --><!-- !cache */
+
+#define TRIE_CACHE_GET(trie, key) \
+	(TRIE_BLOOM_NO(trie, key) ? 0 : PT_(get)(trie, key))
+#define TRIE_CACHE_ADD(trie) (void)0
+#define TRIE_CACHE_STALE(trie) (void)0
+#define TRIE_CACHE_JOIN(left, right) (void)0
+#define TRIE_CACHE_BYTES(trie) 0
+
+#endif /* !cache --> */
+
 /** Looks at only the index of `trie` for potential `prefix` matches,
  and stores them in `it`. @order \O(|`prefix`|) */
 static void PT_(match_prefix)(const struct T_(trie) *const trie,
@@ -208,14 +955,15 @@ static void PT_(match_prefix)(const struct T_(trie) *const trie,
 	struct { size_t cur, next; } byte; /* `key` null checks. */
 	assert(prefix && it);
 	it->root = it->next = it->end = 0;
-	it->leaf = it->leaf_end = 0;
+	it->leaf = it->leaf_begin = it->leaf_end = 0;
 	if(!trie || !(tree = trie->root)) return;
 	for(byte.cur = 0, bit = 0; ; ) { /* Forest. */
 		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
 		while(t.br0 < t.br1) { /* Tree. */
 			const struct trie_branch *const branch = tree->branch + t.br0;
 			/* _Sic_; '\0' is _not_ included for partial match. */
-			for(byte.next = (bit += branch->skip) / CHAR_BIT;
+			bit = PT_(decision)(tree, t.br0, t.lf, bit);
+			for(byte.next = bit / CHAR_BIT;
 				byte.cur <= byte.next; byte.cur++)
 				if(prefix[byte.cur] == '\0') goto finally;
 			if(!TRIE_QUERY(prefix, bit))
@@ -232,19 +980,10 @@ finally:
 		&& t.lf - t.br0 + t.br1 <= tree->bsize);
 	it->root = trie->root;
 	it->next = it->end = tree;
-	it->leaf = t.lf;
+	it->leaf = it->leaf_begin = t.lf;
 	it->leaf_end = t.lf + t.br1 - t.br0 + 1;
 }
 
-/** @return The leftmost key `lf` of `any`. */
-static const char *PT_(sample)(const struct PT_(tree) *tree,
-	unsigned lf) {
-	assert(tree);
-	while(trie_bmp_test(&tree->is_child, lf))
-		tree = tree->leaf[lf].child, lf = 0;
-	return PT_(to_key)(tree->leaf[lf].data);
-}
-
 /** Stores all `prefix` matches in `trie` and stores them in `it`.
  @param[it] Output remains valid until the topology of the trie changes.
  @order \O(|`prefix`|) */
@@ -260,6 +999,63 @@ static void PT_(prefix)(const struct T_(trie) *const trie,
 		it->leaf_end = it->leaf;
 }
 
+/** Only a key that ends in the byte of a branch's bit can be a prefix of
+ `key`, and being the smallest in the branch, it must be the leftmost of the
+ left. We only have to sample it when `key` goes right, otherwise it's still
+ leftmost further down, and only the first time in a byte; after, the keys to
+ the left have that bit set, so they don't end there. Any candidate shares all
+ the bits of the previous one up to it's branch, so the comparison starts at
+ `known`, and we are done as soon as one doesn't match.
+ @return The datum in `trie` whose key is the longest prefix of `key`, or null
+ if there is none. @order \O(|`key`| `h`), where `h` is the height of the
+ forest, for at most one descent to a candidate for each byte of `key` */
+static PT_(type) *PT_(longest_prefix)(const struct T_(trie) *const trie,
+	const char *const key) {
+	struct PT_(tree) *tree;
+	size_t bit; /* `bit \in key`.  */
+	struct { unsigned br0, br1, lf; } t;
+	struct { size_t cur, next; } byte; /* `key` null checks. */
+	PT_(type) *best = 0;
+	size_t known = 0, /* `key` bytes that are the same as `best`. */
+		right = (size_t)-1; /* The byte of the last right. */
+	const char *sample, *a, *b;
+	assert(trie && key);
+	if(!(tree = trie->root)) return 0; /* Empty. */
+	for(byte.cur = 0, bit = 0; ; ) { /* Forest. */
+		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+		while(t.br0 < t.br1) { /* Tree. */
+			const struct trie_branch *const branch = tree->branch + t.br0;
+			bit = PT_(decision)(tree, t.br0, t.lf, bit);
+			for(byte.next = bit / CHAR_BIT;
+				byte.cur < byte.next; byte.cur++)
+				if(key[byte.cur] == '\0') return best; /* Too short. */
+			if(!TRIE_QUERY(key, bit)) {
+				t.br1 = ++t.br0 + branch->left;
+			} else {
+				/* `key[byte.next]` is not null because the bit is set. */
+				if(right != byte.next) {
+					PT_(type) *const lo = PT_(leftmost)(tree, t.lf);
+					right = byte.next;
+					sample = PT_(to_key)(lo);
+					if(sample[byte.next] == '\0') {
+						if(!trie_is_prefix(sample + known, key + known))
+							return best;
+						best = lo, known = byte.next;
+					}
+				}
+				t.br0 += branch->left + 1, t.lf += branch->left + 1;
+			}
+			bit++;
+		}
+		if(!trie_bmp_test(&tree->is_child, t.lf)) break;
+		tree = tree->leaf[t.lf].child;
+	}
+	/* The leaf, itself, might be a prefix or equal to `key`. */
+	sample = PT_(to_key)(tree->leaf[t.lf].data);
+	for(a = sample + known, b = key + known; *a != '\0' && *a == *b; a++, b++);
+	return *a == '\0' ? tree->leaf[t.lf].data : best;
+}
+
 /** @return Allocate a new tree with one undefined leaf. @throws[malloc] */
 static struct PT_(tree) *PT_(tree)(void) {
 	struct PT_(tree) *tree;
@@ -308,10 +1104,11 @@ static void PT_(prnt)(const struct PT_(tree) *const tree) {
 #define QUOTE(name) QUOTE_(name)
 
 /** Adds `x` to `trie`, which must not be present. @return Success.
- @throw[malloc, ERANGE]
- @throw[ERANGE] There is too many bytes similar for the data-type. */
+ @param[finger] If not-null, starts where the last key left off, and
+ remembers the path; splitting forgets it.
+ @throw[malloc, ERANGE] */
 static int PT_(add_unique)(struct T_(trie) *const trie,
-	PT_(type) *const x) {
+	PT_(type) *const x, struct PT_(finger) *const finger) {
 	const char *const key = PT_(to_key)(x);
 	struct { unsigned br0, br1, lf; } t;
 	struct { struct PT_(tree) *tr; struct { size_t tr, diff; } bit; } i;
@@ -319,33 +1116,48 @@ static int PT_(add_unique)(struct T_(trie) *const trie,
 	const char *sample; /* Only used in Find. */
 	int restarts = 0; /* Debug: make sure we only go through twice. */
 	assert(trie && x && key);
+	TRIE_COUNT(adds);
+	TRIE_CACHE_ADD(trie);
 
 start:
 	/* <!-- Solitary. ********************************************************/
-	if(!(i.tr = trie->root)) return (i.tr = PT_(tree)())
-		&& (i.tr->leaf[0].data = x, trie->root = i.tr, 1);
+	if(!(i.tr = trie->root)) {
+		if(finger) finger->depth = 0;
+		return (i.tr = PT_(tree)())
+			&& (i.tr->leaf[0].data = x, TRIE_SCORE_TREE(i.tr),
+			trie->root = i.tr, TRIE_BLOOM_ADD(trie, key), 1);
+	}
 	/* Solitary. --> */
 
 	/* <!-- Find the first bit not in the tree. ******************************/
 	/* Backtracking information; anchor is the first not-full tree. */
 	full.a.tr = 0, full.a.bit = 0, full.n = 0;
+	i.bit.diff = 0;
 	assert(i.tr);
-	for(i.bit.diff = 0; ; i.tr = i.tr->leaf[t.lf].child) { /* Forest. */
+	if(finger) { /* The backtracking above where it starts was kept. */
+		const struct PT_(step) *const step = PT_(finger_start)(finger, key);
+		if(step) i.tr = step->tr, i.bit.diff = step->bit, full.n = step->full,
+			full.a.tr = step->anchor, full.a.bit = step->anchor_bit;
+		finger->key = key;
+	}
+	for( ; ; i.tr = i.tr->leaf[t.lf].child) { /* Forest. */
 		const int is_full = TRIE_BRANCHES <= i.tr->bsize;
+		if(finger) PT_(finger_push)(finger, i.tr, i.bit.diff, 0,
+			full.n, full.a.tr, full.a.bit);
 		full.n = is_full ? full.n + 1 : 0;
 		i.bit.tr = i.bit.diff;
-		sample = PT_(sample)(i.tr, 0);
+		sample = PT_(sample)(i.tr, 0), TRIE_COUNT(samples);
 		t.br0 = 0, t.br1 = i.tr->bsize, t.lf = 0;
 		while(t.br0 < t.br1) { /* Tree. */
 			const struct trie_branch *const branch = i.tr->branch + t.br0;
-			const size_t bit1 = i.bit.diff + branch->skip;
+			const size_t bit1 = PT_(decision)(i.tr, t.br0, t.lf, i.bit.diff);
 			for( ; i.bit.diff < bit1; i.bit.diff++)
 				if(TRIE_DIFF(key, sample, i.bit.diff)) goto found;
 			if(!TRIE_QUERY(key, i.bit.diff)) {
 				t.br1 = ++t.br0 + branch->left;
 			} else {
 				t.br0 += branch->left + 1, t.lf += branch->left + 1;
-				sample = PT_(sample)(i.tr, t.lf);
+				sample = PT_(sample)(i.tr, t.lf), TRIE_COUNT(samples);
 			}
 			i.bit.diff++;
 		} /* Tree. */
@@ -353,11 +1165,8 @@ start:
 		if(!trie_bmp_test(&i.tr->is_child, t.lf)) break;
 		if(!is_full) full.a.tr = i.tr, full.a.bit = i.bit.tr;
 	} /* Forest. */
-	{ /* Got to a leaf. */
-		const size_t limit = i.bit.diff + UCHAR_MAX;
-		while(!TRIE_DIFF(key, sample, i.bit.diff))
-			if(++i.bit.diff > limit) return errno = EILSEQ, 0;
-	}
+	/* Got to a leaf. */
+	while(!TRIE_DIFF(key, sample, i.bit.diff)) i.bit.diff++;
 found:
 	/* Account for choosing the right leaf, (not strictly necessary here?) */
 	if(!!TRIE_QUERY(key, i.bit.diff)) t.lf += t.br1 - t.br0 + 1;
@@ -365,12 +1174,15 @@ found:
 
 	/* <!-- Backtrack and split. *********************************************/
 	if(!full.n) goto insert;
+	if(finger) finger->depth = 0; /* The trees on the path change. */
 	do { /* Split a tree. */
 		struct PT_(tree) *up, *left = 0, *right = 0;
 		unsigned char leaves_split;
 		struct trie_branch *branch;
 		union PT_(leaf) *leaf;
+		const size_t up_bit = full.a.bit;
 		size_t with_promote_bit;
+		TRIE_COUNT(splits);
 		/* Allocate one or two if the root-tree is being split. This is a
 		 sequence point in splitting where the trie is valid. */
 		if(!(up = full.a.tr) && !(up = PT_(tree)()) || !(right = PT_(tree)()))
@@ -381,7 +1193,8 @@ found:
 			t.br0 = 0, t.br1 = up->bsize, t.lf = 0;
 			while(t.br0 < t.br1) { /* Tree. */
 				branch = up->branch + t.br0;
-				full.a.bit += branch->skip, assert(full.a.bit < i.bit.diff);
+				full.a.bit = PT_(decision)(up, t.br0, t.lf, full.a.bit),
+					assert(full.a.bit < i.bit.diff);
 				if(!TRIE_QUERY(key, full.a.bit))
 					t.br1 = ++t.br0 + branch->left++;
 				else
@@ -403,9 +1216,13 @@ found:
 			trie->root = up;
 			t.br0 = 0, t.br1 = up->bsize = 1, t.lf = 0;
 			trie_bmp_set(&up->is_child, 1);
+#ifdef TRIE_SCORE
+			up->max = left->max; /* The same keys. */
+#endif
 		}
 		/* Promote the root of left to the parent's unfilled. */
 		assert(left && left->bsize);
+		with_promote_bit = PT_(decision)(left, 0, 0, full.a.bit);
 		branch = up->branch + t.br0;
 		branch->left = 0;
 		branch->skip = left->branch[0].skip;
@@ -415,14 +1232,14 @@ found:
 			assert(trie_bmp_test(&up->is_child, t.lf + 1));
 		/* Advance the cursor to the next tree. */
 		leaves_split = left->branch[0].left + 1;
-		if((with_promote_bit = full.a.bit + branch->skip) <= i.bit.diff) {
+		if(with_promote_bit <= i.bit.diff) {
 			assert(with_promote_bit < i.bit.diff);
 			full.a.bit = with_promote_bit;
 			full.a.tr = !(TRIE_QUERY(key, full.a.bit)) ? left : right;
 			full.a.bit++;
-		} else {
+		} else { /* The insertion is above; back to the start of `up`. */
 			assert(full.n == 1);
-			full.a.tr = up;
+			full.a.tr = up, full.a.bit = up_bit;
 		}
 		/* Copy the right part of the left to the new right. */
 		right->bsize = left->bsize - leaves_split;
@@ -432,22 +1249,34 @@ found:
 			sizeof *left->leaf * (right->bsize + 1));
 		memcpy(&right->is_child, &left->is_child, sizeof left->is_child);
 		trie_bmp_remove(&right->is_child, 0, leaves_split);
-		/* Move back the branches of the left to account for the promotion. */
-		left->bsize = leaves_split - 1;
-		memmove(left->branch, left->branch + 1,
-			sizeof *left->branch * (left->bsize + 1));
+		if(leaves_split == 1 && full.a.tr == right) {
+			/* The left would be a tree of one leaf that is never added to, as
+			 when adding in order; it goes in `up` instead. */
+			*leaf = left->leaf[0];
+			if(!trie_bmp_test(&left->is_child, 0))
+				trie_bmp_clear(&up->is_child, t.lf);
+			free(left), TRIE_COUNT(frees);
+		} else {
+			/* Move back the branches of the left for the promotion. */
+			left->bsize = leaves_split - 1;
+			memmove(left->branch, left->branch + 1,
+				sizeof *left->branch * (left->bsize + 1));
+			TRIE_SCORE_TREE(left);
+		}
+		TRIE_SCORE_TREE(right);
 	} while(--full.n);
 	i.tr = full.a.tr, i.bit.tr = full.a.bit;
 	/* It was in the promoted bit's skip and "Might be full now," was true.
 	 Don't have enough information to recover, but ca'n't get here twice. */
-	if(TRIE_BRANCHES <= i.tr->bsize) { assert(!restarts++); goto start; }
+	if(TRIE_BRANCHES <= i.tr->bsize)
+		{ assert(!restarts++); TRIE_COUNT(restarts); goto start; }
 	/* Split. --> */
 
 insert: /* Insert into unfilled tree. ****************************************/
 	{
 		union PT_(leaf) *leaf;
 		struct trie_branch *branch;
-		size_t bit0, bit1;
+		size_t bit0, bit1 = 0; /* `bit1` is only read after a branch. */
 		unsigned is_right;
 		assert(key && i.tr && i.tr->bsize < TRIE_BRANCHES
 			&& i.bit.tr <= i.bit.diff);
@@ -456,7 +1285,7 @@ insert: /* Insert into unfilled tree. ****************************************/
 		bit0 = i.bit.tr;
 		while(t.br0 < t.br1) { /* Tree. */
 			branch = i.tr->branch + t.br0;
-			bit1 = bit0 + branch->skip;
+			bit1 = PT_(decision)(i.tr, t.br0, t.lf, bit0);
 			/* Decision bits can never be the site of a difference. */
 			if(i.bit.diff <= bit1) { assert(i.bit.diff < bit1); break; }
 			if(!TRIE_QUERY(key, bit1))
@@ -465,7 +1294,7 @@ insert: /* Insert into unfilled tree. ****************************************/
 				t.br0 += branch->left + 1, t.lf += branch->left + 1;
 			bit0 = bit1 + 1;
 		}
-		assert(bit0 <= i.bit.diff && i.bit.diff - bit0 <= UCHAR_MAX);
+		assert(bit0 <= i.bit.diff);
 		/* Should be the same as the first descent. */
 		if(is_right = !!TRIE_QUERY(key, i.bit.diff)) t.lf += t.br1 - t.br0 + 1;
 
@@ -474,20 +1303,49 @@ insert: /* Insert into unfilled tree. ****************************************/
 		memmove(leaf + 1, leaf, sizeof *leaf * ((i.tr->bsize + 1) - t.lf));
 		branch = i.tr->branch + t.br0;
 		if(t.br0 != t.br1) { /* Split with existing branch. */
-			assert(t.br0 < t.br1 && i.bit.diff + 1 <= bit0 + branch->skip);
-			branch->skip -= i.bit.diff - bit0 + 1;
+			assert(t.br0 < t.br1 && i.bit.diff + 1 <= bit1);
+			branch->skip = trie_skip(bit1 - i.bit.diff - 1);
 		}
 		trie_bmp_insert(&i.tr->is_child, t.lf, 1);
 		memmove(branch + 1, branch, sizeof *branch * (i.tr->bsize - t.br0));
 		branch->left = is_right ? (unsigned char)(t.br1 - t.br0) : 0;
-		branch->skip = (unsigned char)(i.bit.diff - bit0);
+		branch->skip = trie_skip(i.bit.diff - bit0);
 		i.tr->bsize++;
 		leaf->data = x;
 	}
+	TRIE_SCORE_CHANGE(trie, x, x);
+	TRIE_BLOOM_ADD(trie, key);
 	/* PT_(grph)(trie, "graph/" QUOTE(TRIE_NAME) "-add.gv"); */
 	return 1;
 }
 
+/** Adds `x` to `trie` if it's key is not there, starting from `hint`.
+ @param[is_added] Set to whether it was added. @return Success.
+ @throws[malloc, ERANGE] */
+static int PT_(hint_add)(struct T_(trie) *const trie,
+	struct T_(trie_hint) *const hint, PT_(type) *const x,
+	int *const is_added) {
+	/* Going down to check is not the same path as adding when the difference
+	 is in a `skip`, so there are two. */
+	const char *const key = PT_(to_key)(x);
+	PT_(type) **y;
+	assert(trie && hint && x && is_added);
+	*is_added = 0;
+	if(TRIE_BLOOM_NO(trie, key)) {
+		hint->get.depth = 0;
+	} else if((y = PT_(leaf_match)(trie, key, &hint->get))
+		&& !strcmp(PT_(to_key)(*y), key)) {
+		hint->get.key = PT_(to_key)(*y); /* `x` may go away. */
+		return 1;
+	}
+	if(!PT_(add_unique)(trie, x, &hint->add))
+		{ hint->get.depth = hint->add.depth = 0; return 0; }
+	/* It went in the last tree of `add`; the trees below are different. */
+	if(hint->get.depth >= hint->add.depth)
+		hint->get.depth = hint->add.depth ? hint->add.depth - 1 : 0;
+	return *is_added = 1;
+}
+
 /** A bi-predicate; returns true if the `replace` replaces the `original`; used
  in <fn:<T>trie_policy_put>. */
 typedef int (*PT_(replace_fn))(PT_(type) *original, PT_(type) *replace);
@@ -505,20 +1363,26 @@ static int PT_(put)(struct T_(trie) *const trie, PT_(type) *const x,
 	key = PT_(to_key)(x);
 	/* Add if absent. */
 	if(!(leaf = PT_(leaf_get)(trie, key)))
-		{ if(eject) *eject = 0; return PT_(add_unique)(trie, x); }
+		{ if(eject) *eject = 0; return PT_(add_unique)(trie, x, 0); }
 	/* Collision policy. */
 	if(replace && !replace(*leaf, x)) {
 		if(eject) *eject = x;
 	} else {
-		if(eject) *eject = *leaf;
+		PT_(type) *const was = *leaf;
+		if(eject) *eject = was;
 		*leaf = x;
+		TRIE_SCORE_CHANGE(trie, x, was);
+		TRIE_CACHE_STALE(trie);
 	}
 	return 1;
 }
 
-/** @fixme Join when combined-half <= ~TRIE_BRANCH / 2. */
+/** Removes `key` from `trie` or, if `key` is null, the first or the last
+ element, depending on `is_last`, in the same descent.
+ @return The removed element or null if it was not found.
+ @fixme Join when combined-half <= ~TRIE_BRANCH / 2. */
 static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
-	const char *const key) {
+	const char *const key, const int is_last) {
 	struct {
 		struct PT_(tree) *tr;
 		unsigned parent_br, unused;
@@ -531,14 +1395,15 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 	size_t bit;
 	struct { size_t cur, next; } byte;
 	PT_(type) *rm;
-	assert(trie && key);
+	int is_right;
+	assert(trie);
 
 	/* Empty. */
 	if(!(tree = trie->root)) return 0;
 
 	/* Preliminary exploration. */
 	full.tr = 0, full.empty_followers = 0;
-	for(bit = 0; ; tree = tree->leaf[lf].child) {
+	for(byte.cur = 0, bit = 0; ; tree = tree->leaf[lf].child) {
 		if(!tree->bsize) { /* Tree is only one leaf: will be freed. */
 			full.empty_followers++;
 			lf = 0;
@@ -549,10 +1414,16 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 			do {
 				struct trie_branch *const branch
 					= full.tr->branch + (full.parent_br = full.me.br0);
-				for(byte.next = (bit += branch->skip) / CHAR_BIT;
-					byte.cur < byte.next; byte.cur++)
-					if(key[byte.cur] == '\0') return 0;
-				if(!TRIE_QUERY(key, bit))
+				if(key) {
+					bit = PT_(decision)(full.tr, full.me.br0, full.me.lf, bit);
+					for(byte.next = bit / CHAR_BIT;
+						byte.cur < byte.next; byte.cur++)
+						if(key[byte.cur] == '\0') return 0;
+					is_right = !!TRIE_QUERY(key, bit), bit++;
+				} else {
+					is_right = is_last; /* Along the edge of the trie. */
+				}
+				if(!is_right)
 					full.twin.lf = full.me.lf + branch->left + 1,
 					full.twin.br1 = full.me.br1,
 					full.twin.br0 = full.me.br1 = ++full.me.br0 +branch->left;
@@ -560,7 +1431,6 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 					full.twin.br0 = ++full.me.br0,
 					full.twin.br1 = (full.me.br0 += branch->left),
 					full.twin.lf = full.me.lf, full.me.lf += branch->left + 1;
-				bit++;
 			} while(full.me.br0 < full.me.br1);
 			assert(full.me.br0 == full.me.br1
 				&& full.me.lf <= full.tr->bsize);
@@ -569,7 +1439,8 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 		if(!trie_bmp_test(&tree->is_child, lf)) break;
 	}
 	/* We have the candidate leaf; check and see if it is a match. */
-	if(strcmp(key, PT_(to_key)(rm = tree->leaf[lf].data))) return 0;
+	rm = tree->leaf[lf].data;
+	if(key && strcmp(key, PT_(to_key)(rm))) return 0;
 	/* Removed the whole trie. Fixme: 1/0/1/0... makes a lot of `malloc`. */
 	if(!full.tr) {
 		assert(full.empty_followers);
@@ -592,12 +1463,11 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 		assert(full.twin.br0 < full.twin.br1);
 		twin = full.tr->branch + full.twin.br0;
 	}
-	if(twin) { /* Collapsing, as determined previously. */
-		const unsigned collapse_br = full.tr->branch[full.parent_br].skip + 1
-			+ twin->skip;
-		/* Removing the data would cause an overflow in `skip`. */
-		if(collapse_br > UCHAR_MAX) { errno = EILSEQ; return 0; }
-		twin->skip = (unsigned char)collapse_br;
+	if(twin) { /* Collapsing, as determined previously. An escape stays one;
+		 the twin's sides are the same. */
+		twin->skip = trie_skip((size_t)full.tr->branch[full.parent_br].skip
+			+ 1 + twin->skip);
+		TRIE_COUNT(collapses);
 	}
 
 	/* Save the future empty tree for freeing. */
@@ -631,14 +1501,16 @@ static PT_(type) *PT_(remove)(struct T_(trie) *const trie,
 free: /* Free all the unused trees. */
 	if(full.empty_followers) for( ; ; ) {
 		union PT_(leaf) leaf;
-		printf("(Freeing %s.)\n", orcify(tree));
 		assert(tree && !tree->bsize && !!(full.empty_followers - 1)
 			== !!trie_bmp_test(&tree->is_child, 0));
 		leaf = tree->leaf[0];
-		free(tree);
+		free(tree), TRIE_COUNT(frees);
 		if(!--full.empty_followers) break;
 		tree = leaf.child;
 	}
+	TRIE_SCORE_CHANGE(trie, rm, rm);
+	TRIE_BLOOM_REMOVE(trie);
+	TRIE_CACHE_STALE(trie);
 	return rm;
 }
 
@@ -651,7 +1523,20 @@ static void PT_(clear)(struct PT_(tree) *const tree) {
 	assert(tree);
 	for(i = 0; i <= tree->bsize; i++) if(trie_bmp_test(&tree->is_child, i))
 		PT_(clear)(tree->leaf[i].child);
-	free(tree);
+	free(tree), TRIE_COUNT(frees);
+}
+
+/** Called on each datum that is removed by <fn:<T>trie_remove_prefix>. */
+typedef void (*PT_(action_fn))(PT_(type) *);
+
+/** Calls `action` on every datum of `tree` and it's children, in order. */
+static void PT_(each)(struct PT_(tree) *const tree,
+	const PT_(action_fn) action) {
+	unsigned i;
+	assert(tree && action);
+	for(i = 0; i <= tree->bsize; i++) if(trie_bmp_test(&tree->is_child, i))
+		PT_(each)(tree->leaf[i].child, action);
+		else action(tree->leaf[i].data);
 }
 
 /** Counts the sub-tree `any`. @order \O(|`any`|) */
@@ -666,19 +1551,64 @@ static size_t PT_(sub_size)(const struct PT_(tree) *const tree) {
 	return size;
 }
 
-/** Counts the new iterator `it`. @order \O(|`it`|) */
+/** A tree waiting to be counted by <fn:<PT>stats>. */
+struct PT_(visit) { const struct PT_(tree) *tree; size_t depth; };
+
+/** Fills `stats` from `trie` in one pass. Instead of recursing, the children
+ go on a stack; it's at most `TRIE_ORDER` for every level of the forest.
+ @return Success. @throws[realloc, ERANGE] */
+static int PT_(stats)(const struct T_(trie) *const trie,
+	struct trie_stats *const stats) {
+	struct PT_(visit) *stack = 0, v;
+	size_t size = 0, capacity = 0;
+	unsigned i;
+	assert(trie && stats);
+	memset(stats, 0, sizeof *stats);
+	if(!trie->root) return 1;
+	v.tree = trie->root, v.depth = 0;
+	for( ; ; ) {
+		stats->trees++;
+		stats->bsize[v.tree->bsize]++;
+		stats->depth[v.depth < TRIE_STATS_DEPTH
+			? v.depth : TRIE_STATS_DEPTH - 1]++;
+		if(stats->height <= v.depth) stats->height = v.depth + 1;
+		for(i = 0; i < v.tree->bsize; i++)
+			stats->skip[v.tree->branch[i].skip]++;
+		if(capacity - size < TRIE_ORDER) {
+			struct PT_(visit) *const s = realloc(stack,
+				sizeof *stack * (capacity += capacity + TRIE_ORDER));
+			if(!s) { free(stack); if(!errno) errno = ERANGE; return 0; }
+			stack = s;
+		}
+		/* Backwards so they come off in order. */
+		for(i = v.tree->bsize + 1; i; i--) {
+			if(!trie_bmp_test(&v.tree->is_child, i - 1))
+				{ stats->keys++; continue; }
+			stack[size].tree = v.tree->leaf[i - 1].child;
+			stack[size++].depth = v.depth + 1;
+		}
+		if(!size) break;
+		v = stack[--size];
+	}
+	free(stack);
+	stats->bytes = sizeof *trie + stats->trees * sizeof *trie->root
+		+ TRIE_BLOOM_BYTES(trie) + TRIE_CACHE_BYTES(trie);
+	stats->bytes_per_key = (double)stats->bytes / (double)stats->keys;
+	return 1;
+}
+
+/** Counts the range of `it`. @order \O(|`it`|) */
 static size_t PT_(size)(const struct T_(trie_iterator) *const it) {
-	struct PT_(tree) *next;
+	struct PT_(tree) *end;
 	size_t size;
 	unsigned i;
 	assert(it);
-	if(!it->root || !(next = it->next)) return 0;
-	assert(next == it->end
-		&& it->leaf <= it->leaf_end && it->leaf_end <= next->bsize + 1);
-	size = it->leaf_end - it->leaf;
-	for(i = it->leaf; i < it->leaf_end; i++)
-		if(trie_bmp_test(&next->is_child, i))
-		size += PT_(sub_size)(next->leaf[i].child) - 1;
+	if(!it->root || !(end = it->end)) return 0;
+	assert(it->leaf_begin <= it->leaf_end && it->leaf_end <= end->bsize + 1);
+	size = it->leaf_end - it->leaf_begin;
+	for(i = it->leaf_begin; i < it->leaf_end; i++)
+		if(trie_bmp_test(&end->is_child, i))
+		size += PT_(sub_size)(end->leaf[i].child) - 1;
 	return size;
 }
 
@@ -689,112 +1619,1438 @@ static void PT_(begin)(struct PT_(iterator) *const it,
 	const struct T_(trie) *const trie)
 	{ assert(it && trie); it->root = it->next = trie->root; it->leaf = 0; }
 
+/** Climbs from `*tree`, where `*leaf` is off the end, (before the first if
+ `is_prev`,) to the deepest tree on the path from `root`, no higher than
+ `ceiling`, that has leaves in that direction. `*leaf` will be the leaf before
+ or after the path. If there is no such tree, it stays off the end of
+ `ceiling`. @order \O(|`key`|) */
+static void PT_(climb)(struct PT_(tree) *const root,
+	const struct PT_(tree) *const ceiling, struct PT_(tree) **const tree,
+	unsigned *const leaf, const int is_prev) {
+	const struct PT_(tree) *const tree1 = *tree;
+	const char *const key = PT_(sample)(tree1, 0);
+	struct PT_(tree) *tree2 = root;
+	size_t bit2 = 0;
+	struct { unsigned br0, br1, lf; } in_tree2;
+	int is_below = 0;
+	assert(root && ceiling && tree && tree1 && leaf);
+	while(tree2 != tree1) { /* Forest. */
+		in_tree2.br0 = 0, in_tree2.br1 = tree2->bsize, in_tree2.lf = 0;
+		while(in_tree2.br0 < in_tree2.br1) { /* Tree. */
+			const struct trie_branch *const branch2
+				= tree2->branch + in_tree2.br0;
+			bit2 = PT_(decision)(tree2, in_tree2.br0, in_tree2.lf, bit2);
+			if(!TRIE_QUERY(key, bit2))
+				in_tree2.br1 = ++in_tree2.br0 + branch2->left;
+			else
+				in_tree2.br0 += branch2->left + 1,
+				in_tree2.lf += branch2->left + 1;
+			bit2++;
+		}
+		if(tree2 == ceiling) is_below = 1;
+		/* The ceiling is where we are going if nothing else has a leaf. */
+		if(tree2 == ceiling || is_below
+			&& (is_prev ? in_tree2.lf : in_tree2.lf < tree2->bsize))
+			*tree = tree2, *leaf = is_prev ? in_tree2.lf : in_tree2.lf + 1;
+		/* We never reach the bottom, since it breaks up above. */
+		assert(trie_bmp_test(&tree2->is_child, in_tree2.lf));
+		tree2 = tree2->leaf[in_tree2.lf].child;
+	}
+}
+
 /** Advances `it`. @return The previous value or null. @implements next */
 static PT_(type) *PT_(next)(struct PT_(iterator) *const it) {
 	struct PT_(tree) *tree;
 	assert(it);
-	/*printf("_next_\n");*/
 	if(!it->root || !(tree = it->next)) return 0;
 	/* Off the end of the tree. */
 	if(it->leaf > tree->bsize) {
-		/* Definitely a data leaf or else we would have fallen thought.
-		 Unless it had a concurrent modification. That would be bad; don't. */
-		const char *key = PT_(to_key)(tree->leaf[tree->bsize].data);
-		const struct PT_(tree) *tree1 = it->next;
-		struct PT_(tree) *tree2 = it->root;
-		size_t bit2 = 0;
-		const struct trie_branch *branch2;
-		struct { unsigned br0, br1, lf; } in_tree2;
-		assert(key && tree2 && !trie_bmp_test(&tree->is_child, tree->bsize));
-		/*printf("next: over the end of the tree on %s.\n",
-			PT_(to_key)(tree.leaves[it->leaf - 1].data));*/
-		for(it->next = 0; ; ) { /* Forest. */
-			if(tree2 == tree1) break; /* Reached the tree. */
-			in_tree2.br0 = 0, in_tree2.br1 = tree2->bsize, in_tree2.lf = 0;
-			while(in_tree2.br0 < in_tree2.br1) { /* Tree. */
-				branch2 = tree2->branch + in_tree2.br0;
-				bit2 += branch2->skip;
-				if(!TRIE_QUERY(key, bit2))
-					in_tree2.br1 = ++in_tree2.br0 + branch2->left;
-				else
-					in_tree2.br0 += branch2->left + 1,
-					in_tree2.lf += branch2->left + 1;
-				bit2++;
-			}
-			/* Set it to the next value. */
-			if(in_tree2.lf < tree2->bsize)
-				it->next = tree2, it->leaf = in_tree2.lf + 1/*,
-				printf("next: continues in tree %p, leaf %u.\n",
-					(void *)store2.key, it->i)*/;
-			/* We never reach the bottom, since it breaks up above. */
-			assert(trie_bmp_test(&tree2->is_child, in_tree2.lf));
-			tree2 = tree2->leaf[in_tree2.lf].child;
-		}
-		if(!it->next) { /*printf("next: fin\n");*/ it->leaf = 0; return 0; } /* No more. */
-		tree = it->next; /* Update tree. */
-	}
-	/* Fall through the trees. */
+		PT_(climb)(it->root, it->root, &it->next, &it->leaf, 0);
+		if(it->leaf > (tree = it->next)->bsize) return 0; /* No more. */
+	}
+	/* Fall through the trees until we hit data. */
 	while(trie_bmp_test(&tree->is_child, it->leaf))
-		tree = it->next = tree->leaf[it->leaf].child, it->leaf = 0
-		/*, printf("next: fall though.\n")*/; /* !!! */
-	/* Until we hit data. */
-	/*printf("next: more data\n");*/
+		tree = it->next = tree->leaf[it->leaf].child, it->leaf = 0;
 	return tree->leaf[it->leaf++].data;
 }
 
 /* iterate --> */
 
-/** Initializes `trie` to idle. @order \Theta(1) @allow */
-static void T_(trie)(struct T_(trie) *const trie)
-	{ assert(trie); trie->root = 0; }
-
-/** Returns an initialized `trie` to idle. @allow */
-static void T_(trie_)(struct T_(trie) *const trie) {
-	assert(trie);
-	if(trie->root) PT_(clear)(trie->root), T_(trie)(trie);
+/** Advances `it`. @return The value after the cursor or null. */
+static PT_(type) *PT_(forward)(struct T_(trie_iterator) *const it) {
+	struct PT_(tree) *tree;
+	assert(it && (it->next && it->root || !it->next));
+	if(!(tree = it->next)) return 0;
+	/* Off the end of the tree, (and maybe the range.) */
+	if(it->leaf > tree->bsize)
+		PT_(climb)(it->root, it->end, &it->next, &it->leaf, 0),
+		tree = it->next;
+	/* This adds another constraint: instead of ending when the trie has no
+	 more entries like <fn:<PT>next>, we check if it has passed the point. */
+	if(tree == it->end && it->leaf >= it->leaf_end) return 0;
+	while(trie_bmp_test(&tree->is_child, it->leaf))
+		tree = it->next = tree->leaf[it->leaf].child, it->leaf = 0;
+	return tree->leaf[it->leaf++].data;
 }
 
-#if 0
-/** Initializes `trie` from an `array` of pointers-to-`<T>` of `array_size`.
- @return Success. @throws[realloc] @order \O(`array_size`) @allow
- @fixme Write this function, somehow. */
-static int T_(trie_from_array)(struct T_(trie) *const trie,
-	PT_(type) *const*const array, const size_t array_size) {
-	return assert(trie && array && array_size),
-		PT_(init)(trie, array, array_size);
+/** Goes back in `it`. @return The value before the cursor or null. */
+static PT_(type) *PT_(backward)(struct T_(trie_iterator) *const it) {
+	struct PT_(tree) *tree;
+	assert(it && (it->next && it->root || !it->next));
+	if(!(tree = it->next)) return 0;
+	/* Before the start of the tree, (and maybe the range.) */
+	if(!it->leaf)
+		PT_(climb)(it->root, it->end, &it->next, &it->leaf, 1),
+		tree = it->next;
+	if(tree == it->end && it->leaf <= it->leaf_begin) return 0;
+	it->leaf--;
+	while(trie_bmp_test(&tree->is_child, it->leaf))
+		tree = it->next = tree->leaf[it->leaf].child,
+		it->leaf = tree->bsize;
+	return tree->leaf[it->leaf].data;
 }
-#endif
-
-/** @return Looks at only the index of `trie` for potential `key` matches,
- but will ignore the values of the bits that are not in the index.
- @order \O(|`key`|) @allow */
-static PT_(type) *T_(trie_match)(const struct T_(trie) *const trie,
-	const char *const key) { return PT_(match)(trie, key); }
 
-/** @return Exact match for `key` in `trie` or null no such item exists.
- @order \O(|`key`|), <Thareja 2011, Data>. @allow */
-static PT_(type) *T_(trie_get)(const struct T_(trie) *const trie,
-	const char *const key) { return PT_(get)(trie, key); }
+/** Descends from `tree` with `key`, as if it had zeros after it, to the only
+ leaf that could have all the same decision bits.
+ @return Whether `key` is different from that leaf; if so, `diff` is the first
+ bit where they differ. */
+static int PT_(diff)(const struct PT_(tree) *tree, const char *const key,
+	size_t *const diff) {
+	struct { unsigned br0, br1, lf; } t;
+	const size_t key_bits = (strlen(key) + 1) * CHAR_BIT;
+	size_t bit, i;
+	const char *sample;
+	assert(tree && key && diff);
+	for(bit = 0; ; tree = tree->leaf[t.lf].child) { /* Forest. */
+		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+		while(t.br0 < t.br1) { /* Tree. */
+			const struct trie_branch *const branch = tree->branch + t.br0;
+			bit = PT_(decision)(tree, t.br0, t.lf, bit);
+			if(bit >= key_bits || !TRIE_QUERY(key, bit))
+				t.br1 = ++t.br0 + branch->left;
+			else
+				t.br0 += branch->left + 1, t.lf += branch->left + 1;
+			bit++;
+		}
+		if(!trie_bmp_test(&tree->is_child, t.lf)) break;
+	}
+	sample = PT_(to_key)(tree->leaf[t.lf].data);
+	for(i = 0; key[i] == sample[i]; i++) if(key[i] == '\0') return 0;
+	for(i *= CHAR_BIT; !TRIE_DIFF(key, sample, i); i++);
+	*diff = i;
+	return 1;
+}
 
-static PT_(type) *T_(trie_remove)(struct T_(trie) *const trie,
-	const char *const key) { return PT_(remove)(trie, key); }
+/** Fills `it` with the entire `trie`. Unlike <fn:<PT>prefix> with the empty
+ string, it doesn't go down a root of one leaf, so it's suitable for
+ <fn:<PT>lower_bound>. */
+static void PT_(whole)(const struct T_(trie) *const trie,
+	struct T_(trie_iterator) *const it) {
+	struct PT_(tree) *const root = trie->root;
+	assert(trie && it);
+	it->root = it->next = it->end = root;
+	it->leaf = it->leaf_begin = 0;
+	it->leaf_end = root ? root->bsize + 1u : 0;
+}
 
-/** Adds a pointer to `x` into `trie` if the key doesn't exist already.
- @return If the key did not exist and it was created, returns true. If the key
- of `x` is already in `trie`, or an error occurred, returns false.
- @throws[realloc, ERANGE] Set `errno = 0` before to tell if the operation
- failed due to error. @order \O(|`key`|) @allow */
-static int T_(trie_add)(struct T_(trie) *const trie, PT_(type) *const x)
-	{ return assert(trie && x),
-	PT_(get)(trie, PT_(to_key)(x)) ? 0 : PT_(add_unique)(trie, x); }
+/** Moves the cursor of `it`, which must be over the entire trie, to before
+ the first key that is not less than `key`. After a candidate leaf, (as if
+ `key` had zeros after it,) we know the bit they differ, and all the keys in
+ the sub-tree that branches after it are on the same side of `key`.
+ @order \O(|`key`|) */
+static void PT_(lower_bound)(struct T_(trie_iterator) *const it,
+	const char *const key) {
+	struct PT_(tree) *tree;
+	struct { unsigned br0, br1, lf; } t;
+	size_t bit, diff;
+	int is_diff;
+	assert(it && key && it->end == it->root);
+	if(!(tree = it->root)) return;
+	if(!(is_diff = PT_(diff)(tree, key, &diff))) diff = (size_t)~0;
+	/* Decision bits before `diff` are the same for `key` and the candidate. */
+	for(bit = 0; ; tree = tree->leaf[t.lf].child) {
+		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+		while(t.br0 < t.br1) {
+			const struct trie_branch *const branch = tree->branch + t.br0;
+			if((bit = PT_(decision)(tree, t.br0, t.lf, bit)) > diff)
+				goto found;
+			assert(bit < diff);
+			if(!TRIE_QUERY(key, bit))
+				t.br1 = ++t.br0 + branch->left;
+			else
+				t.br0 += branch->left + 1, t.lf += branch->left + 1;
+			bit++;
+		}
+		if(!trie_bmp_test(&tree->is_child, t.lf)) break;
+	}
+found:
+	it->next = tree;
+	it->leaf = is_diff && TRIE_QUERY(key, diff)
+		? t.lf + t.br1 - t.br0 + 1 : t.lf;
+}
 
-/** Updates or adds a pointer to `x` into `trie`.
- @param[eject] If not null, on success it will hold the overwritten value or
- a pointer-to-null if it did not overwrite any value.
- @return Success. @throws[realloc, ERANGE] @order \O(|`key`|) @allow */
-static int T_(trie_put)(struct T_(trie) *const trie, PT_(type) *const x,
-	PT_(type) **const eject)
-	{ return assert(trie && x), PT_(put)(trie, x, eject, 0); }
+/** Advances `it`, which is over the entire trie, to the first value that is
+ not less than `key`; it tries the next one before looking it up.
+ @return The value or null. */
+static PT_(type) *PT_(catch_up)(struct T_(trie_iterator) *const it,
+	const char *const key) {
+	PT_(type) *x;
+	if(!(x = PT_(forward)(it)) || strcmp(PT_(to_key)(x), key) >= 0) return x;
+	PT_(lower_bound)(it, key);
+	return PT_(forward)(it);
+}
+
+/** Adds `a` `op` `b` to `out`, which must be distinct and start idle. We go
+ through both in order together, but when one is behind and not needed, it
+ catches up with the other, skipping whole sub-trees.
+ @return Success. @throws[malloc, ERANGE] */
+static int PT_(set)(struct T_(trie) *const out, const struct T_(trie) *const a,
+	const struct T_(trie) *const b, const enum trie_set_op op) {
+	struct T_(trie_iterator) ia, ib;
+	struct PT_(finger) finger; /* `out` is added in order. */
+	PT_(type) *x, *y;
+	int cmp;
+	assert(out && a && b && out != a && out != b && !out->root);
+	finger.key = 0, finger.depth = 0;
+	PT_(whole)(a, &ia), x = PT_(forward)(&ia);
+	PT_(whole)(b, &ib), y = PT_(forward)(&ib);
+	while(x || y) {
+		cmp = !x ? 1 : !y ? -1 : strcmp(PT_(to_key)(x), PT_(to_key)(y));
+		if(!cmp) {
+			if(op != TRIE_DIFFERENCE && !PT_(add_unique)(out, x, &finger))
+				return 0;
+			x = PT_(forward)(&ia), y = PT_(forward)(&ib);
+		} else if(cmp < 0) {
+			if(op == TRIE_INTERSECT) {
+				if(!y) break;
+				x = PT_(catch_up)(&ia, PT_(to_key)(y));
+			} else {
+				if(!PT_(add_unique)(out, x, &finger)) return 0;
+				x = PT_(forward)(&ia);
+			}
+		} else {
+			if(op == TRIE_UNION) {
+				if(!PT_(add_unique)(out, y, &finger)) return 0;
+				y = PT_(forward)(&ib);
+			} else {
+				if(!x) break;
+				y = PT_(catch_up)(&ib, PT_(to_key)(x));
+			}
+		}
+	}
+	return 1;
+}
+
+/* <!-- split/join: only the trees on the edge where they part are new. */
+
+/** Adds `*carry` to the `skip` of `branch` and zeros it. The sides of
+ `branch` are the same, so if it doesn't fit, it's escaped. */
+static void PT_(absorb)(struct trie_branch *const branch,
+	size_t *const carry) {
+	assert(branch && carry);
+	branch->skip = trie_skip(branch->skip + *carry), *carry = 0;
+}
+
+/** @return The first tree down from `tree` that has branches, or null if it's
+ trees of one leaf that end in data. */
+static struct PT_(tree) *PT_(branched)(struct PT_(tree) *tree) {
+	assert(tree);
+	while(!tree->bsize) {
+		if(!trie_bmp_test(&tree->is_child, 0)) return 0;
+		tree = tree->leaf[0].child;
+	}
+	return tree;
+}
+
+/** Copies leaves `[0, q)` of `src` into `dst`, with the branches they still
+ need. A branch with nothing on the right goes, and it's `skip` and the bit it
+ decided are added to `*carry`, which goes to the next branch that stays; if
+ there is none, it's left over for leaf `q - 1`. */
+static void PT_(left_part)(const struct PT_(tree) *const src, const unsigned q,
+	struct PT_(tree) *const dst, size_t *const carry) {
+	struct { unsigned br0, br1, lf; } t;
+	unsigned out = 0, i;
+	assert(src && dst && carry && q && q <= src->bsize + 1u);
+	memcpy(dst->leaf, src->leaf, sizeof *src->leaf * q);
+	dst->is_child = src->is_child;
+	for(i = q; i <= src->bsize; i++) trie_bmp_clear(&dst->is_child, i);
+	t.br0 = 0, t.br1 = src->bsize, t.lf = 0;
+	while(t.br0 < t.br1) {
+		const struct trie_branch *const branch = src->branch + t.br0;
+		if(q > t.lf + t.br1 - t.br0) { /* All of the rest. */
+			memcpy(dst->branch + out, branch, sizeof *branch * (t.br1 - t.br0));
+			PT_(absorb)(dst->branch + out, carry);
+			out += t.br1 - t.br0;
+			break;
+		}
+		if(q <= t.lf + branch->left + 1u) { /* Nothing on the right. */
+			*carry += branch->skip + 1u;
+			t.br1 = ++t.br0 + branch->left;
+		} else { /* The branch and all it's left. */
+			memcpy(dst->branch + out, branch,
+				sizeof *branch * (branch->left + 1u));
+			PT_(absorb)(dst->branch + out, carry);
+			out += branch->left + 1u;
+			t.br0 += branch->left + 1, t.lf += branch->left + 1;
+		}
+	}
+	assert(out + 1 == q);
+	dst->bsize = (unsigned char)out, dst->skip = 0;
+}
+
+/** Copies leaves `[q, bsize]` of `src` into `dst`; the mirror of
+ <fn:<PT>left_part>, except the rights of the branches that stay come after
+ their part of the left. */
+static void PT_(right_part)(const struct PT_(tree) *const src, const unsigned q,
+	struct PT_(tree) *const dst, size_t *const carry) {
+	struct { unsigned br0, br1, lf; } t;
+	struct { unsigned br0, br1; } rights[TRIE_BRANCHES];
+	unsigned out = 0, r = 0;
+	assert(src && dst && carry && q <= src->bsize);
+	memcpy(dst->leaf, src->leaf + q,
+		sizeof *src->leaf * (src->bsize + 1u - q));
+	dst->is_child = src->is_child;
+	trie_bmp_remove(&dst->is_child, 0, q);
+	t.br0 = 0, t.br1 = src->bsize, t.lf = 0;
+	while(t.br0 < t.br1) {
+		const struct trie_branch *const branch = src->branch + t.br0;
+		if(q <= t.lf) { /* All of the rest. */
+			memcpy(dst->branch + out, branch, sizeof *branch * (t.br1 - t.br0));
+			PT_(absorb)(dst->branch + out, carry);
+			out += t.br1 - t.br0;
+			break;
+		}
+		if(q > t.lf + branch->left) { /* Nothing on the left. */
+			*carry += branch->skip + 1u;
+			t.br0 += branch->left + 1, t.lf += branch->left + 1;
+		} else { /* The branch, some of it's left, and later, it's right. */
+			dst->branch[out] = *branch;
+			dst->branch[out].left = (unsigned char)(t.lf + branch->left - q);
+			PT_(absorb)(dst->branch + out, carry);
+			out++;
+			rights[r].br0 = t.br0 + branch->left + 1, rights[r++].br1 = t.br1;
+			t.br1 = ++t.br0 + branch->left;
+		}
+	}
+	while(r) r--, memcpy(dst->branch + out, src->branch + rights[r].br0,
+		sizeof *src->branch * (rights[r].br1 - rights[r].br0)),
+		out += rights[r].br1 - rights[r].br0;
+	assert(out == src->bsize - q);
+	dst->bsize = (unsigned char)out, dst->skip = 0;
+}
+
+/** The first `levels` trees down the edge of `trie` are new, the right edge
+ if `is_right`, otherwise the left; the ones that are one leaf are replaced by
+ the leaf. */
+static void PT_(unwrap)(struct T_(trie) *const trie, size_t levels,
+	const int is_right) {
+	struct PT_(tree) *up = 0, *tree;
+	unsigned lf = 0;
+	assert(trie);
+	for( ; levels; levels--) {
+		tree = up ? up->leaf[lf].child : trie->root;
+		if(tree->bsize)
+			{ up = tree, lf = is_right ? tree->bsize : 0; continue; }
+		if(up) {
+			up->leaf[lf] = tree->leaf[0];
+			if(!trie_bmp_test(&tree->is_child, 0))
+				trie_bmp_clear(&up->is_child, lf);
+		} else if(trie_bmp_test(&tree->is_child, 0)) {
+			trie->root = tree->leaf[0].child;
+		} else {
+			break; /* The root is one datum. */
+		}
+		free(tree), TRIE_COUNT(frees);
+	}
+}
+
+/** Moves the values in `trie` that are not less than `key` to `right`, which
+ must be idle. The boundary goes down one path, which is found like
+ <fn:<PT>lower_bound>; the trees on it are split in two and everything off it
+ moves as it is. It only goes into a child if it has keys on both sides.
+ @return Success. @throws[malloc] Nothing changes on error. */
+static int PT_(split)(struct T_(trie) *const trie, const char *const key,
+	struct T_(trie) *const right) {
+	struct PT_(tree) *tree, *next = 0, *l = 0, *r = 0;
+	struct { struct PT_(tree) *l, *r; } root = { 0, 0 }, more = { 0, 0 };
+	struct { size_t l, r; } carry = { 0, 0 };
+	struct { unsigned l, r; } q;
+	struct { unsigned br0, br1, lf; } t;
+	size_t bit, diff, levels = 0;
+	int is_diff, is_last;
+	assert(trie && key && right && trie != right && !right->root);
+	if(!(tree = trie->root)) return 1;
+	if(strcmp(key, PT_(sample)(tree, 0)) <= 0)
+		return right->root = tree, trie->root = 0, 1;
+	if(strcmp(key, PT_(to_key)(PT_(rightmost)(tree))) > 0) return 1;
+	if(!(is_diff = PT_(diff)(tree, key, &diff))) diff = (size_t)~0;
+	for(bit = 0; ; tree = next) { /* Forest. */
+		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+		while(t.br0 < t.br1) { /* Tree. */
+			const struct trie_branch *const branch = tree->branch + t.br0;
+			if((bit = PT_(decision)(tree, t.br0, t.lf, bit)) > diff) break;
+			if(!TRIE_QUERY(key, bit))
+				t.br1 = ++t.br0 + branch->left;
+			else
+				t.br0 += branch->left + 1, t.lf += branch->left + 1;
+			bit++;
+		}
+		is_last = 1;
+		if(t.br0 < t.br1) { /* The sub-tree is on one side. */
+			q.l = q.r = TRIE_QUERY(key, diff) ? t.lf + t.br1 - t.br0 + 1 : t.lf;
+		} else if(!trie_bmp_test(&tree->is_child, t.lf)) { /* Candidate. */
+			q.l = q.r = is_diff && TRIE_QUERY(key, diff) ? t.lf + 1 : t.lf;
+		} else if(next = tree->leaf[t.lf].child,
+			strcmp(key, PT_(sample)(next, 0)) <= 0) {
+			q.l = q.r = t.lf;
+		} else if(strcmp(key, PT_(to_key)(PT_(rightmost)(next))) > 0) {
+			q.l = q.r = t.lf + 1;
+		} else { /* It goes through the child. */
+			q.l = t.lf + 1, q.r = t.lf, is_last = 0;
+		}
+		assert(q.l && q.r <= tree->bsize);
+		if(!(l = PT_(tree)())) goto catch;
+		if(!(r = PT_(tree)())) { free(l); goto catch; }
+		PT_(left_part)(tree, q.l, l, &carry.l);
+		PT_(right_part)(tree, q.r, r, &carry.r);
+		if(levels) more.l->leaf[more.l->bsize].child = l,
+			more.r->leaf[0].child = r;
+		else root.l = l, root.r = r;
+		more.l = l, more.r = r, levels++;
+		if(is_last) break;
+	}
+	/* The left-over goes to the trees that move whole on the edge. */
+	more.l = carry.l && trie_bmp_test(&l->is_child, l->bsize)
+		? PT_(branched)(l->leaf[l->bsize].child) : 0;
+	more.r = carry.r && trie_bmp_test(&r->is_child, 0)
+		? PT_(branched)(r->leaf[0].child) : 0;
+	if(more.l) PT_(absorb)(more.l->branch, &carry.l);
+	if(more.r) PT_(absorb)(more.r->branch, &carry.r);
+	/* The old trees on the path; the left parts know which leaf. */
+	for(tree = trie->root, l = root.l, bit = levels; --bit;
+		l = l->leaf[l->bsize].child)
+		next = tree->leaf[l->bsize].child, free(tree), TRIE_COUNT(frees),
+		tree = next;
+	free(tree), TRIE_COUNT(frees);
+	trie->root = root.l, right->root = root.r;
+	PT_(unwrap)(trie, levels, 1), PT_(unwrap)(right, levels, 0);
+	TRIE_SCORE_EDGE(trie, 1), TRIE_SCORE_EDGE(right, 0);
+	return 1;
+catch:
+	if(levels) {
+		for(l = root.l, r = root.r; --levels; l = more.l, r = more.r)
+			more.l = l->leaf[l->bsize].child, more.r = r->leaf[0].child,
+			free(l), free(r);
+		free(l), free(r);
+	}
+	return 0;
+}
+
+/* A sub-tree of `tree` with branches `[br0, br1)` and leaves starting at
+ `lf`, or if `tree` is null, the entire `whole`. */
+struct PT_(part) {
+	struct PT_(tree) *tree, *whole;
+	unsigned br0, br1, lf;
+};
+
+/* Going down the edge of a trie where it meets another in <fn:<PT>join>; the
+ right edge of the left trie if `is_right`, or the left edge of the right. It
+ is before `next` when `tree` is null or at a leaf, (`next` is null if it's
+ data,) otherwise, at `t.br0`. The trees it went into are `entered`. */
+struct PT_(edge) {
+	struct PT_(tree) *tree, *next;
+	struct { unsigned br0, br1, lf; } t;
+	size_t bit, entered;
+	int is_right;
+};
+
+/** Starts `e` above `root`. */
+static void PT_(edge_begin)(struct PT_(edge) *const e,
+	struct PT_(tree) *const root, const int is_right) {
+	assert(e && root);
+	e->tree = 0, e->next = root;
+	e->t.br0 = e->t.br1 = e->t.lf = 0;
+	e->bit = 0, e->entered = 0, e->is_right = is_right;
+}
+
+/** @return The bit of the next decision of `e`, or `(size_t)~0` if it ends
+ in data. */
+static size_t PT_(edge_bit)(const struct PT_(edge) *const e) {
+	struct PT_(tree) *tree;
+	assert(e);
+	if(e->tree && e->t.br0 < e->t.br1)
+		return PT_(decision)(e->tree, e->t.br0, e->t.lf, e->bit);
+	if(!e->next || !(tree = PT_(branched)(e->next))) return (size_t)~0;
+	return PT_(decision)(tree, 0, 0, e->bit);
+}
+
+/** Takes the next decision of `e`, which must exist, and puts the sub-tree
+ on the other side in `off`. */
+static void PT_(edge_next)(struct PT_(edge) *const e,
+	struct PT_(part) *const off) {
+	const struct trie_branch *branch;
+	assert(e && off);
+	if(!e->tree || e->t.br0 == e->t.br1) { /* Into the next tree. */
+		struct PT_(tree) *tree = e->next;
+		assert(tree);
+		while(e->entered++, !tree->bsize) tree = tree->leaf[0].child;
+		e->tree = tree, e->t.br0 = 0, e->t.br1 = tree->bsize, e->t.lf = 0;
+	}
+	branch = e->tree->branch + e->t.br0;
+	e->bit = PT_(decision)(e->tree, e->t.br0, e->t.lf, e->bit) + 1;
+	off->tree = e->tree, off->whole = 0;
+	if(e->is_right) {
+		off->br0 = e->t.br0 + 1, off->br1 = off->br0 + branch->left;
+		off->lf = e->t.lf;
+		e->t.br0 += branch->left + 1, e->t.lf += branch->left + 1;
+	} else {
+		off->br0 = e->t.br0 + 1 + branch->left, off->br1 = e->t.br1;
+		off->lf = e->t.lf + branch->left + 1;
+		e->t.br1 = ++e->t.br0 + branch->left;
+	}
+	if(e->t.br0 == e->t.br1)
+		e->next = trie_bmp_test(&e->tree->is_child, e->t.lf)
+		? e->tree->leaf[e->t.lf].child : 0;
+}
+
+/** Puts the rest of `e` in `rest`. */
+static void PT_(edge_rest)(const struct PT_(edge) *const e,
+	struct PT_(part) *const rest) {
+	assert(e && rest);
+	rest->tree = e->tree, rest->whole = e->tree ? 0 : e->next;
+	rest->br0 = e->t.br0, rest->br1 = e->t.br1, rest->lf = e->t.lf;
+}
+
+/** Copies `part` to `tree` at branch `br` and leaf `lf`. */
+static void PT_(part_copy)(struct PT_(tree) *const tree, const unsigned br,
+	const unsigned lf, const struct PT_(part) *const part) {
+	const unsigned n = part->br1 - part->br0;
+	unsigned i;
+	assert(tree && part && br + n <= TRIE_BRANCHES);
+	if(!part->tree) {
+		assert(!n && part->whole);
+		tree->leaf[lf].child = part->whole, trie_bmp_set(&tree->is_child, lf);
+		return;
+	}
+	memcpy(tree->branch + br, part->tree->branch + part->br0,
+		sizeof *tree->branch * n);
+	memcpy(tree->leaf + lf, part->tree->leaf + part->lf,
+		sizeof *tree->leaf * (n + 1));
+	for(i = 0; i <= n; i++)
+		if(trie_bmp_test(&part->tree->is_child, part->lf + i))
+		trie_bmp_set(&tree->is_child, lf + i);
+}
+
+/* Builds the trees of <fn:<PT>join> in pre-order. A decision from the right
+ trie goes before the rest, but what's off it goes after, so it's `deferred`.
+ If `is_dry`, it only counts the `trees`, otherwise, they come from `spare`. */
+struct PT_(zip) {
+	struct PT_(tree) *root, *tree, *spare;
+	unsigned br, lf, hang, deferrals;
+	struct { unsigned br; struct PT_(part) off; } deferred[TRIE_BRANCHES];
+	size_t bit, trees;
+	int is_dry;
+};
+
+/** Starts a new tree in `z`. */
+static void PT_(zip_tree)(struct PT_(zip) *const z) {
+	assert(z);
+	if(!z->is_dry) {
+		assert(z->spare);
+		z->tree = z->spare, z->spare = z->spare->leaf[0].child;
+		z->tree->bsize = 0, z->tree->skip = 0;
+		trie_bmp_clear_all(&z->tree->is_child);
+		if(!z->trees) z->root = z->tree;
+	}
+	z->trees++, z->br = z->lf = z->hang = z->deferrals = 0;
+}
+
+/** Appends `part` to `z`. */
+static void PT_(zip_part)(struct PT_(zip) *const z,
+	const struct PT_(part) *const part) {
+	const unsigned n = part->br1 - part->br0;
+	assert(z && part);
+	if(!z->is_dry) PT_(part_copy)(z->tree, z->br, z->lf, part);
+	z->br += n, z->lf += n + 1;
+}
+
+/** Finishes the tree in `z` with the deferred. */
+static void PT_(zip_finish)(struct PT_(zip) *const z) {
+	assert(z);
+	while(z->deferrals) {
+		const unsigned br = z->deferred[--z->deferrals].br;
+		if(!z->is_dry)
+			z->tree->branch[br].left = (unsigned char)(z->br - br - 1);
+		PT_(zip_part)(z, &z->deferred[z->deferrals].off);
+	}
+	assert(z->lf == z->br + 1);
+	if(!z->is_dry) z->tree->bsize = (unsigned char)z->br;
+}
+
+/** The rest of `z` is in a new tree. */
+static void PT_(zip_cut)(struct PT_(zip) *const z) {
+	struct PT_(tree) *tree;
+	unsigned lf;
+	assert(z);
+	tree = z->tree, lf = z->lf++;
+	PT_(zip_finish)(z);
+	PT_(zip_tree)(z);
+	if(!z->is_dry)
+		tree->leaf[lf].child = z->tree, trie_bmp_set(&tree->is_child, lf);
+}
+
+/** Appends a decision at `bit` to `z`; `off` goes on the left if `is_left`,
+ otherwise it's deferred to the right. */
+static void PT_(zip_branch)(struct PT_(zip) *const z, const size_t bit,
+	const struct PT_(part) *const off, const int is_left) {
+	const unsigned n = off->br1 - off->br0;
+	assert(z && off && bit >= z->bit);
+	if(z->br + z->hang + 1 + n > TRIE_BRANCHES) PT_(zip_cut)(z);
+	if(!z->is_dry) {
+		struct trie_branch *const branch = z->tree->branch + z->br;
+		branch->left = (unsigned char)n;
+		branch->skip = trie_skip(bit - z->bit);
+	}
+	z->br++, z->bit = bit + 1;
+	if(is_left) { PT_(zip_part)(z, off); return; }
+	z->deferred[z->deferrals].br = z->br - 1;
+	z->deferred[z->deferrals++].off = *off;
+	z->hang += n;
+}
+
+/** Moves everything in `right` to `left`, where every key in `left` is less.
+ The right edge of `left` and the left edge of `right` are zipped together in
+ order of decision bit into new trees, until the bit where the greatest of
+ `left` and least of `right` differ, which gets a new decision between what's
+ left of each; what's off the edges moves as it is. The edges are gone through
+ twice; first to count the trees, so it can't fail half way.
+ @return Success. @throws[malloc] @throws[EDOM] They are not in order.
+ Nothing changes on error. */
+static int PT_(join)(struct T_(trie) *const left,
+	struct T_(trie) *const right) {
+	struct PT_(zip) z;
+	struct PT_(edge) e[2];
+	struct PT_(part) off, rest[2];
+	struct PT_(tree) *tree, *next;
+	size_t d, bit[2], i;
+	const char *a, *b;
+	unsigned n[2];
+	assert(left && right && left != right);
+	if(!right->root) return 1;
+	if(!left->root) return left->root = right->root, right->root = 0, 1;
+	a = PT_(to_key)(PT_(rightmost)(left->root));
+	b = PT_(sample)(right->root, 0);
+	for(d = 0; a[d] == b[d]; d++) if(a[d] == '\0') return errno = EDOM, 0;
+	for(d *= CHAR_BIT; !TRIE_DIFF(a, b, d); d++);
+	if(!TRIE_QUERY(b, d)) return errno = EDOM, 0;
+	z.spare = 0;
+	for(z.is_dry = 1; ; z.is_dry = 0) {
+		PT_(edge_begin)(e + 0, left->root, 1);
+		PT_(edge_begin)(e + 1, right->root, 0);
+		z.trees = 0, z.bit = 0, PT_(zip_tree)(&z);
+		for( ; ; ) { /* The decisions on the edges before `d`. */
+			bit[0] = PT_(edge_bit)(e + 0), bit[1] = PT_(edge_bit)(e + 1);
+			assert(bit[0] != d && bit[1] != d);
+			if(bit[0] > d && bit[1] > d) break;
+			i = bit[1] < bit[0];
+			PT_(edge_next)(e + i, &off);
+			PT_(zip_branch)(&z, bit[i], &off, !i);
+		}
+		PT_(edge_rest)(e + 0, rest + 0), PT_(edge_rest)(e + 1, rest + 1);
+		n[0] = rest[0].br1 - rest[0].br0, n[1] = rest[1].br1 - rest[1].br0;
+		if(z.br + z.hang + 1 + n[0] + n[1] > TRIE_BRANCHES) PT_(zip_cut)(&z);
+		if(1 + n[0] + n[1] > TRIE_BRANCHES) { /* The bigger gets a tree. */
+			i = n[0] < n[1];
+			if(!z.is_dry) {
+				tree = z.spare, z.spare = z.spare->leaf[0].child;
+				tree->skip = 0, trie_bmp_clear_all(&tree->is_child);
+				PT_(part_copy)(tree, 0, 0, rest + i);
+				tree->bsize = (unsigned char)n[i];
+				tree->branch[0].skip = trie_skip(bit[i] - d - 1);
+				rest[i].tree = 0, rest[i].whole = tree;
+			}
+			z.trees++, n[i] = 0, rest[i].br1 = rest[i].br0;
+		}
+		/* The rests start below `d`; a tree that moves whole is changed. */
+		if(!z.is_dry) for(i = 0; i < 2; i++) {
+			if(bit[i] == (size_t)~0 || n[i]) continue;
+			tree = PT_(branched)(rest[i].tree ? rest[i].tree->leaf[rest[i].lf]
+				.child : rest[i].whole);
+			tree->branch[0].skip = trie_skip(bit[i] - d - 1);
+		}
+		if(!z.is_dry) {
+			struct trie_branch *const branch = z.tree->branch + z.br;
+			branch->left = (unsigned char)n[0];
+			branch->skip = trie_skip(d - z.bit);
+		}
+		for(z.br++, i = 0; i < 2; i++) {
+			const unsigned br = z.br;
+			PT_(zip_part)(&z, rest + i);
+			if(!z.is_dry && n[i])
+				z.tree->branch[br].skip = trie_skip(bit[i] - d - 1);
+		}
+		PT_(zip_finish)(&z);
+		if(!z.is_dry) break;
+		for(i = 0; i < z.trees; i++) { /* Now that we know how many. */
+			if(!(tree = PT_(tree)())) {
+				while(z.spare) tree = z.spare, z.spare = tree->leaf[0].child,
+					free(tree);
+				return 0;
+			}
+			tree->leaf[0].child = z.spare, z.spare = tree;
+		}
+	}
+	assert(!z.spare);
+	/* The trees on the edges are all copied. */
+	for(i = 0; i < 2; i++) for(tree = i ? right->root : left->root;
+		e[i].entered; tree = next, e[i].entered--)
+		next = e[i].entered > 1
+		? tree->leaf[i ? 0 : tree->bsize].child : 0,
+		free(tree), TRIE_COUNT(frees);
+	left->root = z.root, right->root = 0;
+	TRIE_SCORE_KEY(left, a), TRIE_SCORE_KEY(left, b);
+	return 1;
+}
+
+/* split/join --> */
+
+/** Every key that starts with `prefix` is on one side of the last branch
+ that `prefix` decides, (or it's the whole `trie`.) That side is a sub-tree of
+ one tree, `full`, so one `memmove` takes it out, and the branch goes with it;
+ the twin takes up the `skip`, like <fn:<PT>remove>. The children on that
+ side are freed whole. @return Success. */
+static int PT_(remove_prefix)(struct T_(trie) *const trie,
+	const char *const prefix, const PT_(action_fn) action) {
+	struct {
+		struct PT_(tree) *tr;
+		unsigned parent_br;
+		struct { unsigned br0, br1, lf; } me, twin;
+	} full;
+	struct PT_(tree) *tree;
+	struct { unsigned br0, br1, lf; } t;
+	size_t bit, carry;
+	struct { size_t cur, next; } byte;
+	struct trie_branch *twin;
+	unsigned i, n;
+	assert(trie && prefix);
+	if(!(tree = trie->root)) return 1; /* Empty. */
+	full.tr = 0;
+	for(byte.cur = 0, bit = 0; ; tree = tree->leaf[t.lf].child) { /* Forest. */
+		t.br0 = 0, t.br1 = tree->bsize, t.lf = 0;
+		while(t.br0 < t.br1) { /* Tree. */
+			const struct trie_branch *const branch = tree->branch + t.br0;
+			bit = PT_(decision)(tree, t.br0, t.lf, bit);
+			for(byte.next = bit / CHAR_BIT;
+				byte.cur <= byte.next; byte.cur++)
+				if(prefix[byte.cur] == '\0') goto found;
+			full.tr = tree, full.parent_br = t.br0;
+			if(!TRIE_QUERY(prefix, bit))
+				full.twin.lf = t.lf + branch->left + 1,
+				full.twin.br1 = t.br1,
+				full.twin.br0 = t.br1 = ++t.br0 + branch->left;
+			else
+				full.twin.br0 = ++t.br0,
+				full.twin.br1 = (t.br0 += branch->left),
+				full.twin.lf = t.lf, t.lf += branch->left + 1;
+			full.me.br0 = t.br0, full.me.br1 = t.br1, full.me.lf = t.lf;
+			bit++;
+		}
+		if(!trie_bmp_test(&tree->is_child, t.lf)) break;
+	}
+found:
+	/* The index only looked at some of the bits. */
+	if(strncmp(prefix, PT_(sample)(tree, t.lf), strlen(prefix))) return 1;
+	if(!full.tr) { /* Every key. */
+		if(action) PT_(each)(trie->root, action);
+		PT_(clear)(trie->root), trie->root = 0;
+		TRIE_BLOOM_STALE(trie), TRIE_CACHE_STALE(trie);
+		return 1;
+	}
+	/* The twin takes the parent's place. */
+	carry = (size_t)full.tr->branch[full.parent_br].skip + 1;
+	if(full.twin.br0 < full.twin.br1) twin = full.tr->branch + full.twin.br0;
+	else twin = trie_bmp_test(&full.tr->is_child, full.twin.lf)
+		&& (tree = PT_(branched)(full.tr->leaf[full.twin.lf].child))
+		? tree->branch : 0;
+	if(twin) PT_(absorb)(twin, &carry);
+	/* `n` leaves go, and the same number of branches, counting the parent. */
+	n = full.me.br1 - full.me.br0 + 1;
+	for(i = full.me.lf; i < full.me.lf + n; i++)
+		if(trie_bmp_test(&full.tr->is_child, i)) {
+			if(action) PT_(each)(full.tr->leaf[i].child, action);
+			PT_(clear)(full.tr->leaf[i].child);
+		} else if(action) {
+			action(full.tr->leaf[i].data);
+		}
+	/* The branches above that have it on the left have `n` less. */
+	for(t.br0 = 0; t.br0 != full.parent_br; ) {
+		struct trie_branch *const branch = full.tr->branch + t.br0;
+		if(full.parent_br <= t.br0 + branch->left)
+			branch->left = (unsigned char)(branch->left - n), t.br0++;
+		else
+			t.br0 += branch->left + 1;
+	}
+	memmove(full.tr->branch + full.me.br0, full.tr->branch + full.me.br1,
+		sizeof *full.tr->branch * (full.tr->bsize - full.me.br1));
+	memmove(full.tr->branch + full.parent_br, full.tr->branch
+		+ full.parent_br + 1, sizeof *full.tr->branch
+		* (full.tr->bsize - (n - 1) - full.parent_br - 1));
+	memmove(full.tr->leaf + full.me.lf, full.tr->leaf + full.me.lf + n,
+		sizeof *full.tr->leaf * (full.tr->bsize + 1 - full.me.lf - n));
+	for(i = full.me.lf; i + n <= full.tr->bsize; i++)
+		if(trie_bmp_test(&full.tr->is_child, i + n))
+			trie_bmp_set(&full.tr->is_child, i);
+		else
+			trie_bmp_clear(&full.tr->is_child, i);
+	for( ; i <= full.tr->bsize; i++) trie_bmp_clear(&full.tr->is_child, i);
+	full.tr->bsize = (unsigned char)(full.tr->bsize - n);
+	TRIE_SCORE_KEY(trie, prefix);
+	TRIE_BLOOM_STALE(trie), TRIE_CACHE_STALE(trie);
+	return 1;
+}
+
+/* <!-- fuzzy */
+
+/** Called on each datum within the edit distance of the key in
+ <fn:<T>trie_fuzzy>, with it's distance. */
+typedef void (*PT_(fuzzy_fn))(PT_(type) *, unsigned edits);
+
+/* A sub-tree waiting in <fn:<PT>fuzzy>, branches `[br0, br1)` and leaves
+ starting at `lf` of `tree`, starting at `bit`, and the rows of edit
+ distances that are good for the first `depth` bytes of it's keys. */
+struct PT_(near) { const struct PT_(tree) *tree;
+	unsigned br0, br1, lf; size_t bit, depth; };
+
+/* The state of <fn:<PT>fuzzy>: the Levenshtein distances from `key` of
+ `size` to the keys in a sub-tree are `row[i]` for the first `i` bytes; each
+ row has `size + 1`. */
+struct PT_(fuzzy) { const char *key; size_t size, rows; unsigned max, *row; };
+
+/** Fills in the rows of `f` from `depth` to `to` with the bytes of `sample`.
+ @return Whether any key that starts with them can still be in the budget.
+ @throws[realloc, ERANGE] Sets `*is_error`. */
+static int PT_(fuzzy_rows)(struct PT_(fuzzy) *const f,
+	const char *const sample, size_t depth, const size_t to,
+	int *const is_error) {
+	size_t j;
+	assert(f && sample && depth <= to && is_error);
+	if(f->rows <= to) {
+		size_t rows = f->rows ? f->rows : 16;
+		unsigned *row;
+		while(rows <= to) rows *= 2;
+		if(!(row = realloc(f->row, sizeof *row * rows * (f->size + 1))))
+			{ if(!errno) errno = ERANGE; return *is_error = 1, 0; }
+		f->row = row, f->rows = rows;
+	}
+	for( ; depth < to; depth++) {
+		const unsigned *const up = f->row + depth * (f->size + 1);
+		unsigned *const row = f->row + (depth + 1) * (f->size + 1), min;
+		min = row[0] = up[0] + 1;
+		for(j = 1; j <= f->size; j++) {
+			unsigned e = up[j - 1] + (sample[depth] != f->key[j - 1]);
+			if(up[j] + 1 < e) e = up[j] + 1;
+			if(row[j - 1] + 1 < e) e = row[j - 1] + 1;
+			if((row[j] = e) < min) min = e;
+		}
+		if(min > f->max) return 0;
+	}
+	return 1;
+}
+
+/** Calls `fuzzy` on every datum in `trie` whose key is at most `max` edits
+ from `key`, in order. It goes depth-first; the bytes that all the keys of a
+ branch share are sampled once, and a branch is skipped as soon as they are
+ too far. @return Success. @throws[realloc, ERANGE] */
+static int PT_(fuzzy)(const struct T_(trie) *const trie,
+	const char *const key, const unsigned max,
+	const PT_(fuzzy_fn) fuzzy) {
+	struct PT_(fuzzy) f;
+	struct PT_(near) *stack = 0, n;
+	size_t size = 0, capacity = 0, j;
+	int is_error = 0;
+	assert(trie && key && fuzzy);
+	if(!trie->root) return 1;
+	f.key = key, f.size = strlen(key), f.max = max, f.rows = 0, f.row = 0;
+	if(!PT_(fuzzy_rows)(&f, "", 0, 0, &is_error)) goto finally;
+	for(j = 0; j <= f.size; j++) f.row[j] = (unsigned)j;
+	n.tree = trie->root, n.br0 = 0, n.br1 = n.tree->bsize, n.lf = 0;
+	n.bit = 0, n.depth = 0;
+	for( ; ; ) {
+		if(n.br0 < n.br1) { /* The bytes before the decision are shared. */
+			const struct trie_branch *const branch = n.tree->branch + n.br0;
+			const size_t bit = PT_(decision)(n.tree, n.br0, n.lf, n.bit),
+				to = bit / CHAR_BIT;
+			if(to <= n.depth || PT_(fuzzy_rows)(&f,
+				PT_(sample)(n.tree, n.lf), n.depth, to, &is_error)) {
+				if(capacity <= size) {
+					struct PT_(near) *const s = realloc(stack,
+						sizeof *stack * (capacity += capacity + 16));
+					if(!s) { if(!errno) errno = ERANGE; is_error = 1; break; }
+					stack = s;
+				}
+				if(n.depth < to) n.depth = to;
+				n.bit = bit + 1;
+				stack[size] = n; /* The right waits. */
+				stack[size].br0 = n.br0 + 1 + branch->left;
+				stack[size++].lf = n.lf + branch->left + 1;
+				n.br1 = ++n.br0 + branch->left;
+				continue;
+			}
+			if(is_error) break;
+		} else if(trie_bmp_test(&n.tree->is_child, n.lf)) {
+			n.tree = n.tree->leaf[n.lf].child;
+			n.br0 = 0, n.br1 = n.tree->bsize, n.lf = 0;
+			continue;
+		} else { /* The rest of the key is known. */
+			PT_(type) *const data = n.tree->leaf[n.lf].data;
+			const char *const sample = PT_(to_key)(data);
+			const size_t len = strlen(sample);
+			if(PT_(fuzzy_rows)(&f, sample, n.depth, len, &is_error)
+				&& f.row[len * (f.size + 1) + f.size] <= max)
+				fuzzy(data, f.row[len * (f.size + 1) + f.size]);
+			if(is_error) break;
+		}
+		if(!size) break;
+		n = stack[--size];
+	}
+finally:
+	free(stack), free(f.row);
+	return !is_error;
+}
+
+/* fuzzy --> */
+
+/* <!-- glob */
+
+/** @return The first datum that matches the glob of `g`, and comes after
+ `after`, if it's not null, in the sub-tree with branches `[br0, br1)` and
+ leaves from `lf` of `tree`, starting at `bit`, having checked the first
+ `byte` of the keys. The branches that the literal start of the glob
+ decides go one way, like <fn:<PT>match_prefix>; after that, the bytes
+ before a decision are the same in the whole sub-tree, so one sample
+ decides if any of it can match. */
+static PT_(type) *PT_(glob_next)(const struct T_(trie_glob) *const g,
+	const struct PT_(tree) *tree, unsigned br0, unsigned br1, unsigned lf,
+	size_t bit, size_t byte, const char *after) {
+	PT_(type) *x;
+	assert(g && tree);
+	for( ; ; ) {
+		const struct trie_branch *branch;
+		size_t d;
+		int is_right;
+		if(br0 == br1) { /* Leaf. */
+			if(trie_bmp_test(&tree->is_child, lf)) {
+				tree = tree->leaf[lf].child, br0 = 0, br1 = tree->bsize, lf = 0;
+				continue;
+			}
+			x = tree->leaf[lf].data;
+			return !after && trie_glob_match(g->pattern, PT_(to_key)(x))
+				? x : 0;
+		}
+		branch = tree->branch + br0;
+		d = PT_(decision)(tree, br0, lf, bit), bit = d + 1;
+		if(byte < d / CHAR_BIT) {
+			if(!trie_glob_prefix(g->pattern, PT_(sample)(tree, lf), byte,
+				d / CHAR_BIT)) return 0;
+			byte = d / CHAR_BIT;
+		}
+		if(d / CHAR_BIT < g->literal) { /* Only one side can match. */
+			is_right = !!TRIE_QUERY(g->pattern, d);
+			if(after && is_right != !!TRIE_QUERY(after, d)) {
+				if(!is_right) return 0; /* All of it is before. */
+				after = 0; /* All of it is after. */
+			}
+		} else if(after && TRIE_QUERY(after, d)) {
+			is_right = 1; /* The left is all before. */
+		} else {
+			if(x = PT_(glob_next)(g, tree, br0 + 1, br0 + 1 + branch->left,
+				lf, bit, byte, after)) return x;
+			is_right = 1, after = 0;
+		}
+		if(is_right) br0 += branch->left + 1, lf += branch->left + 1;
+		else br1 = ++br0 + branch->left;
+	}
+}
+
+/* glob --> */
+
+/* <!-- group */
+
+/** Called by <fn:<T>trie_group_counts> on each group: the first `length` of
+ `key` are it's name, and the `count` values in it are in the range of
+ `group`, in order. */
+typedef void (*PT_(group_fn))(const char *key, size_t length, size_t count,
+	struct T_(trie_iterator) *group);
+
+/* The parameters of <fn:<PT>group>. */
+struct PT_(grouping) { const struct T_(trie) *trie; const char *prefix;
+	size_t prefix_length, depth; char delim; PT_(group_fn) group; };
+
+/** Calls `g.group` on the groups of the sub-tree with branches `[br0, br1)`
+ and leaves from `lf` of `tree`, starting at `bit`. The first `from` bytes of
+ the keys don't end a group, and `is_prefix` is whether they have the
+ prefix. The bytes before a decision are shared, so once they decide the
+ group, the whole sub-tree is counted at once. */
+static void PT_(group)(const struct PT_(grouping) *const g,
+	struct PT_(tree) *tree, unsigned br0, unsigned br1, unsigned lf,
+	size_t bit, size_t from, int is_prefix) {
+	assert(g && tree);
+	for( ; ; ) {
+		const struct trie_branch *const branch = tree->branch + br0;
+		const char *key;
+		size_t d = 0, known, length;
+		if(br0 == br1 && trie_bmp_test(&tree->is_child, lf)) {
+			tree = tree->leaf[lf].child, br0 = 0, br1 = tree->bsize, lf = 0;
+			continue;
+		}
+		if(br0 == br1) { /* All of the key. */
+			key = PT_(to_key)(tree->leaf[lf].data), known = strlen(key);
+		} else {
+			d = PT_(decision)(tree, br0, lf, bit), bit = d + 1;
+			key = PT_(sample)(tree, lf), known = d / CHAR_BIT;
+		}
+		if(!is_prefix && known >= g->prefix_length) {
+			if(strncmp(key, g->prefix, g->prefix_length)) return;
+			is_prefix = 1;
+		}
+		if(is_prefix && ((length = trie_group_length(key, from, known,
+			g->depth, g->delim)) != (size_t)-1 || br0 == br1)) {
+			struct T_(trie_iterator) it;
+			it.root = g->trie->root, it.next = it.end = tree;
+			it.leaf = it.leaf_begin = lf, it.leaf_end = lf + br1 - br0 + 1;
+			g->group(key, length == (size_t)-1 ? known : length,
+				PT_(size)(&it), &it);
+			return;
+		}
+		if(br0 == br1) return; /* Shorter than the prefix. */
+		if(is_prefix) from = known;
+		if(known < g->prefix_length) { /* Only one side has the prefix. */
+			if(TRIE_QUERY(g->prefix, d))
+				br0 += branch->left + 1, lf += branch->left + 1;
+			else br1 = ++br0 + branch->left;
+			continue;
+		}
+		PT_(group)(g, tree, br0 + 1, br0 + 1 + branch->left, lf, bit, from,
+			is_prefix);
+		br0 += branch->left + 1, lf += branch->left + 1;
+	}
+}
+
+/* group --> */
+
+/* <!-- merge: a loser tree over the iterators. */
+
+/** @return Whether the head of source `a` of `m` comes before `b`; null is
+ after everything, and equal keys are in the order of the tries. */
+static int PT_(merge_less)(const struct T_(trie_merge) *const m,
+	const size_t a, const size_t b) {
+	PT_(type) *const x = m->source[a].head, *const y = m->source[b].head;
+	int cmp;
+	if(!x || !y) return !!x || !y && a < b;
+	return (cmp = strcmp(PT_(to_key)(x), PT_(to_key)(y))) ? cmp < 0 : a < b;
+}
+
+/** Plays the matches under `node` of `m`; the sources are leaves
+ `[size, 2 size)`. @return The winner. */
+static size_t PT_(merge_play)(struct T_(trie_merge) *const m,
+	const size_t node) {
+	size_t a, b;
+	if(node >= m->size) return node - m->size;
+	a = PT_(merge_play)(m, node << 1), b = PT_(merge_play)(m, node << 1 | 1);
+	if(PT_(merge_less)(m, a, b)) return m->source[node].loser = b, a;
+	else return m->source[node].loser = a, b;
+}
+
+/** Moves source `i` of `m` to it's next value in range. */
+static void PT_(merge_forward)(struct T_(trie_merge) *const m,
+	const size_t i) {
+	PT_(type) *const x = PT_(forward)(&m->source[i].it);
+	m->source[i].head = x && m->to && strcmp(PT_(to_key)(x), m->to) >= 0
+		? 0 : x;
+}
+
+/** Advances the winner of `m` and plays it's matches up to the root, only
+ against the losers on it's path. */
+static void PT_(merge_replay)(struct T_(trie_merge) *const m) {
+	size_t winner = m->source[0].loser, node, loser;
+	PT_(merge_forward)(m, winner);
+	for(node = (winner + m->size) >> 1; node; node >>= 1)
+		if(PT_(merge_less)(m, loser = m->source[node].loser, winner))
+			m->source[node].loser = winner, winner = loser;
+	m->source[0].loser = winner;
+}
+
+/** Fills `m` with the `size` `tries` in `[from, to)`, or with `prefix`.
+ @return Success. @throws[malloc, ERANGE] */
+static int PT_(merge)(struct T_(trie_merge) *const m,
+	const struct T_(trie) *const tries, const size_t size,
+	const char *const prefix, const char *const from, const char *const to,
+	const enum trie_merge_policy policy) {
+	size_t i;
+	assert(m && (tries || !size));
+	m->source = 0, m->size = 0, m->to = to, m->policy = policy;
+	if(!size) return 1;
+	if(size > (size_t)-1 / sizeof *m->source) return errno = ERANGE, 0;
+	if(!(m->source = malloc(sizeof *m->source * size)))
+		{ if(!errno) errno = ERANGE; return 0; }
+	m->size = size;
+	for(i = 0; i < size; i++) {
+		struct PT_(merge_source) *const s = m->source + i;
+		if(prefix) PT_(prefix)(tries + i, prefix, &s->it);
+		else if(PT_(whole)(tries + i, &s->it), from)
+			PT_(lower_bound)(&s->it, from);
+		PT_(merge_forward)(m, i);
+	}
+	m->source[0].loser = PT_(merge_play)(m, 1);
+	return 1;
+}
+
+/* merge --> */
+
+/* <!-- clone */
+
+/** Called by <fn:<T>trie_clone> on each value. @return The copy, with the
+ same key, or null on error. */
+typedef PT_(type) *(*PT_(copy_fn))(PT_(type) *);
+
+/* Leaf of a tree in the clone that's still the child in the original. */
+struct PT_(graft) { struct PT_(tree) *tree; unsigned leaf; };
+
+/** Copies the trees of `trie` into idle `clone` whole, without recursion; the
+ children are grafted on from a stack. A graft that's not copied is cut
+ before the clone is freed on error.
+ @return Success. @throws[malloc, realloc, ERANGE] */
+static int PT_(clone)(struct T_(trie) *const clone,
+	const struct T_(trie) *const trie, const PT_(copy_fn) copy) {
+	struct PT_(graft) *stack = 0, g;
+	size_t size = 0, capacity = 0;
+	struct PT_(tree) *tree;
+	unsigned i;
+	assert(clone && trie && clone != trie && !clone->root);
+	if(!trie->root) return 1;
+	for(g.tree = 0, g.leaf = 0; ; ) {
+		/* Room for the children before the tree, so they can't fail. */
+		if(capacity - size < TRIE_ORDER) {
+			struct PT_(graft) *const s = realloc(stack,
+				sizeof *stack * (capacity += capacity + TRIE_ORDER));
+			if(!s) { if(!errno) errno = ERANGE; goto catch; }
+			stack = s;
+		}
+		if(!(tree = PT_(tree)())) goto catch;
+		memcpy(tree, g.tree ? g.tree->leaf[g.leaf].child : trie->root,
+			sizeof *tree);
+		if(g.tree) g.tree->leaf[g.leaf].child = tree, g.tree = 0;
+		else clone->root = tree;
+		/* Backwards so they come off in order. */
+		for(i = tree->bsize + 1; i; i--)
+			if(trie_bmp_test(&tree->is_child, i - 1))
+			stack[size].tree = tree, stack[size++].leaf = i - 1;
+		if(copy) for(i = 0; i <= tree->bsize; i++)
+			if(!trie_bmp_test(&tree->is_child, i)
+			&& !(tree->leaf[i].data = copy(tree->leaf[i].data))) goto catch;
+		if(!size) break;
+		g = stack[--size];
+	}
+	free(stack);
+#ifdef TRIE_BLOOM
+	if(trie->bloom) { /* It's not an error to be unfiltered. */
+		const int errno_ = errno;
+		if(clone->bloom = trie_bloom(trie->bloom->blocks)) {
+			memcpy(clone->bloom->word, trie->bloom->word,
+				sizeof *clone->bloom->word * trie->bloom->blocks
+				* (TRIE_BLOOM_BLOCK / TRIE_BLOOM_WORD));
+			clone->bloom->size = trie->bloom->size;
+			clone->bloom->stale = trie->bloom->stale;
+		}
+		errno = errno_;
+	}
+#endif
+	TRIE_CACHE_ADD(clone);
+	return 1;
+catch:
+	if(g.tree) trie_bmp_clear(&g.tree->is_child, g.leaf);
+	while(size) g = stack[--size], trie_bmp_clear(&g.tree->is_child, g.leaf);
+	free(stack);
+	if(clone->root) PT_(clear)(clone->root), clone->root = 0;
+	return 0;
+}
+
+/* clone --> */
+
+/** Initializes `trie` to idle. @order \Theta(1) @allow */
+static void T_(trie)(struct T_(trie) *const trie) {
+	assert(trie); trie->root = 0;
+#ifdef TRIE_BLOOM
+	trie->bloom = 0;
+#endif
+#ifdef TRIE_CACHE
+	trie->cache = 0;
+#endif
+#ifdef TRIE_JOURNAL
+	trie->journal = 0;
+#endif
+}
+
+/** Returns an initialized `trie` to idle. @allow */
+static void T_(trie_)(struct T_(trie) *const trie) {
+	assert(trie);
+	if(trie->root) PT_(clear)(trie->root);
+#ifdef TRIE_BLOOM
+	free(trie->bloom);
+#endif
+#ifdef TRIE_CACHE
+	free(trie->cache);
+#endif
+	T_(trie)(trie);
+}
+
+#if 0
+/** Initializes `trie` from an `array` of pointers-to-`<T>` of `array_size`.
+ @return Success. @throws[realloc] @order \O(`array_size`) @allow
+ @fixme Write this function, somehow. */
+static int T_(trie_from_array)(struct T_(trie) *const trie,
+	PT_(type) *const*const array, const size_t array_size) {
+	return assert(trie && array && array_size),
+		PT_(init)(trie, array, array_size);
+}
+#endif
+
+/** @return Looks at only the index of `trie` for potential `key` matches,
+ but will ignore the values of the bits that are not in the index.
+ @order \O(|`key`|) @allow */
+static PT_(type) *T_(trie_match)(const struct T_(trie) *const trie,
+	const char *const key) { return PT_(match)(trie, key); }
+
+/** @return Exact match for `key` in `trie` or null no such item exists.
+ With `TRIE_CACHE`, this writes the cache of `trie`, so concurrent readers
+ race. @order \O(|`key`|), <Thareja 2011, Data>. @allow */
+static PT_(type) *T_(trie_get)(const struct T_(trie) *const trie,
+	const char *const key)
+	{ return TRIE_RECORD_OP(TRIE_RECORD_GET, key), TRIE_CACHE_GET(trie, key); }
+
+/** @return The value in `trie` whose key is the longest prefix of `key`, (all
+ of it or less,) or null if no key in `trie` is a prefix of `key`. This is
+ useful for routing tables, _etc_, where one would otherwise call
+ <fn:<T>trie_get> with every truncation of `key`. @order \O(|`key`| `h`),
+ where `h` is the height of the forest, but only bytes of `key` that a key
+ could end at go down to it @allow */
+static PT_(type) *T_(trie_longest_prefix)(const struct T_(trie) *const trie,
+	const char *const key) { return PT_(longest_prefix)(trie, key); }
+
+/** Calls `fuzzy` on every value in `trie`, in order, whose key is at most
+ `max_edits` insertions, deletions, or substitutions of bytes from `key`,
+ (Levenshtein distance.) This is useful for spelling suggestions, where one
+ would otherwise call <fn:<T>trie_get> on every candidate. Sub-trees that
+ can't be within `max_edits` are skipped. @return Success.
+ @throws[realloc, ERANGE] @order \O(|`key`| \cdot |visited|) @allow */
+static int T_(trie_fuzzy)(const struct T_(trie) *const trie,
+	const char *const key, const unsigned max_edits,
+	const PT_(fuzzy_fn) fuzzy)
+	{ return PT_(fuzzy)(trie, key, max_edits, fuzzy); }
+
+/** Counts the values in `trie` of keys that start with `prefix` by group, the
+ first `depth` bytes of the key, or through the first `delim` after the
+ prefix, whichever is shorter, and calls `group` on each, in order. A key
+ that's shorter is it's own group. For example, the keys per directory are
+ `delim = '/'` and `depth = (size_t)-1`. Once the shared bytes of a sub-tree
+ decide it's group, it's counted by the trees in it, without going through
+ it's values; for sums, `group` can go through the values in it's range.
+ @param[delim] If zero, only `depth` counts.
+ @order \O(|groups| \cdot |`key`| + |`trie`| / `TRIE_ORDER`) @allow */
+static void T_(trie_group_counts)(const struct T_(trie) *const trie,
+	const char *const prefix, const size_t depth, const char delim,
+	const PT_(group_fn) group) {
+	struct PT_(grouping) g;
+	assert(trie && prefix && group);
+	if(!trie->root) return;
+	g.trie = trie, g.prefix = prefix, g.prefix_length = strlen(prefix);
+	g.depth = depth < g.prefix_length ? g.prefix_length : depth;
+	g.delim = delim, g.group = group;
+	PT_(group)(&g, trie->root, 0, trie->root->bsize, 0, 0, g.prefix_length,
+		!g.prefix_length);
+}
+
+/** Fills `glob` with `pattern` on `trie`, to go through the values whose keys
+ match with <fn:<T>trie_glob_next>. `?` matches any byte, `*` any run of
+ bytes, `[...]` any byte in the class, which may have ranges, such as
+ `[a-z0-9]`, `[!...]` or `[^...]` any byte not, and `\` escapes the next.
+ @param[pattern] Must stay valid while `glob` is. @order \Theta(1) @allow */
+static void T_(trie_glob)(const struct T_(trie) *const trie,
+	const char *const pattern, struct T_(trie_glob) *const glob) {
+	assert(trie && pattern && glob);
+	glob->root = trie->root, glob->pattern = pattern;
+	glob->literal = strcspn(pattern, "?*[\\"), glob->last = 0;
+}
+
+/** Advances `glob`. The trees that the literal start of the pattern goes
+ through are found like <fn:<T>trie_prefix>, and after that, only the
+ sub-trees that could match up to the first `*` are gone into, in order.
+ @return The value of the next key that matches the pattern, or null.
+ @order \O(|`pattern`| \cdot |visited|) @allow */
+static PT_(type) *T_(trie_glob_next)(struct T_(trie_glob) *const glob) {
+	PT_(type) *x;
+	assert(glob);
+	if(!glob->root) return 0;
+	if(!(x = PT_(glob_next)(glob, glob->root, 0, glob->root->bsize, 0, 0, 0,
+		glob->last ? PT_(to_key)(glob->last) : 0))) glob->root = 0;
+	return glob->last = x;
+}
+
+/** Fills `merge` with the values of keys that start with `prefix` in the
+ `size` `tries`, to go through them in order with <fn:<T>trie_merge_next>,
+ where equal keys are by `policy`. It allocates room for each trie; free it
+ with <fn:<T>trie_merge_>.
+ @param[tries] An array of `size` tries that must stay valid while `merge` is.
+ @return Success. @throws[malloc, ERANGE] @order \O(`size` \cdot |`prefix`|)
+ @allow */
+static int T_(trie_merge)(struct T_(trie_merge) *const merge,
+	const struct T_(trie) *const tries, const size_t size,
+	const char *const prefix, const enum trie_merge_policy policy)
+	{ return assert(prefix), PT_(merge)(merge, tries, size, prefix, 0, 0,
+	policy); }
+
+/** Fills `merge` like <fn:<T>trie_merge>, but with the keys that are not
+ less than `from` and less than `to`.
+ @param[from, to] If null, the range is open on that side. `to` must stay
+ valid while `merge` is.
+ @return Success. @throws[malloc, ERANGE] @order \O(`size` \cdot |`from`|)
+ @allow */
+static int T_(trie_merge_range)(struct T_(trie_merge) *const merge,
+	const struct T_(trie) *const tries, const size_t size,
+	const char *const from, const char *const to,
+	const enum trie_merge_policy policy)
+	{ return PT_(merge)(merge, tries, size, 0, from, to, policy); }
+
+/** Advances `merge`. The tries are the leaves of a loser tree, so getting the
+ next is one comparison per level, instead of sorting them all together.
+ @return The value with the next key in all the tries, or null when there
+ are no more. @order \O(\log `size` \cdot |`key`|), amortized over the
+ values. @allow */
+static PT_(type) *T_(trie_merge_next)(struct T_(trie_merge) *const merge) {
+	PT_(type) *x, *y;
+	assert(merge);
+	if(!merge->size || !(x = merge->source[merge->source[0].loser].head))
+		return 0;
+	PT_(merge_replay)(merge);
+	if(merge->policy == TRIE_MERGE_ALL) return x;
+	/* The rest with the same key are next, in the order of the tries. */
+	while((y = merge->source[merge->source[0].loser].head)
+		&& !strcmp(PT_(to_key)(x), PT_(to_key)(y))) {
+		if(merge->policy == TRIE_MERGE_LAST) x = y;
+		PT_(merge_replay)(merge);
+	}
+	return x;
+}
+
+/** Frees `merge`, which is then empty. @allow */
+static void T_(trie_merge_)(struct T_(trie_merge) *const merge) {
+	if(!merge) return;
+	free(merge->source), merge->source = 0, merge->size = 0;
+}
+
+/** Removes `key` from `trie`.
+ @return The value that was removed, or null if `key` was not in `trie`.
+ @order \O(|`key`|) @allow */
+static PT_(type) *T_(trie_remove)(struct T_(trie) *const trie,
+	const char *const key) { return assert(key),
+	TRIE_RECORD_OP(TRIE_RECORD_REMOVE, key), TRIE_JOURNAL_REMOVE(trie,
+	TRIE_BLOOM_NO(trie, key) ? 0 : PT_(remove)(trie, key, 0)); }
+
+/** Adds a pointer to `x` into `trie` if the key doesn't exist already.
+ @return If the key did not exist and it was created, returns true. If the key
+ of `x` is already in `trie`, or an error occurred, returns false.
+ @throws[realloc, ERANGE] Set `errno = 0` before to tell if the operation
+ failed due to error. @order \O(|`key`|) @allow */
+static int T_(trie_add)(struct T_(trie) *const trie, PT_(type) *const x)
+	{ return assert(trie && x),
+	TRIE_RECORD_OP(TRIE_RECORD_ADD, PT_(to_key)(x)),
+	!TRIE_BLOOM_NO(trie, PT_(to_key)(x)) && PT_(get)(trie, PT_(to_key)(x))
+	? 0 : TRIE_JOURNAL_IS(trie, PT_(add_unique)(trie, x, 0),
+	TRIE_RECORD_ADD, x); }
+
+/** Looks up each of `keys` of `keys_size` in `trie` and stores the exact
+ match or null at the same place in `values`. Each starts from the deepest
+ tree that the key before went through that this one must, too. If `keys` are
+ sorted, they share most of the path, and it is more like a merge than going
+ from the root each time. They don't have to be; it's just slower.
+ @return The number found. @order \O(|`keys`| |`key`|), but closer to
+ \O(|`keys`| + |`trie`|) when they're sorted and dense. @allow */
+static size_t T_(trie_get_sorted_batch)(const struct T_(trie) *const trie,
+	const char *const*const keys, const size_t keys_size,
+	PT_(type) **const values) {
+	struct PT_(finger) finger;
+	PT_(type) **x;
+	size_t i, found = 0;
+	assert(trie && (keys && values || !keys_size));
+	finger.key = 0, finger.depth = 0;
+	for(i = 0; i < keys_size; i++) {
+		TRIE_RECORD_OP(TRIE_RECORD_GET, keys[i]);
+		values[i] = !TRIE_BLOOM_NO(trie, keys[i])
+			&& (x = PT_(leaf_match)(trie, keys[i], &finger))
+			&& !strcmp(PT_(to_key)(*x), keys[i]) ? (found++, *x) : 0;
+	}
+	return found;
+}
+
+/** Initializes `hint` to start from the root the next time it's used.
+ @order \Theta(1) @allow */
+static void T_(trie_hint)(struct T_(trie_hint) *const hint) {
+	assert(hint);
+	hint->get.key = hint->add.key = 0, hint->get.depth = hint->add.depth = 0;
+}
+
+/** Adds each of `values` of `values_size` whose key is not in `trie`, like
+ <fn:<T>trie_add>, but starting from where the one before left off, like
+ <fn:<T>trie_get_sorted_batch>. It is fastest if `values` are sorted by key.
+ @return The number added. @throws[realloc, ERANGE] Stops at the
+ first error; set `errno = 0` before to tell.
+ @order \O(|`values`| |`key`|), less when sorted. @allow */
+static size_t T_(trie_add_sorted_batch)(struct T_(trie) *const trie,
+	PT_(type) *const*const values, const size_t values_size) {
+	struct T_(trie_hint) hint;
+	size_t i, added = 0;
+	int is_added;
+	assert(trie && (values || !values_size));
+	T_(trie_hint)(&hint);
+	for(i = 0; i < values_size; i++) {
+		TRIE_RECORD_OP(TRIE_RECORD_ADD, PT_(to_key)(values[i]));
+		if(!PT_(hint_add)(trie, &hint, values[i], &is_added)) break;
+		if(TRIE_JOURNAL_IS(trie, is_added, TRIE_RECORD_ADD, values[i]))
+			added++;
+	}
+	return added;
+}
+
+/** Adds a pointer to `x` into `trie` if the key doesn't exist already, like
+ <fn:<T>trie_add>, but starting from where the last key added with `hint`
+ was. Keys that are in order, and especially ones that are greater than all
+ before, share most of the path, and so the trees above aren't visited again.
+ @param[hint] Initialized with <fn:<T>trie_hint>; invalidated by changes to
+ `trie` other than through it.
+ @return If the key did not exist and it was created, returns true. If the key
+ of `x` is already in `trie`, or an error occurred, returns false.
+ @throws[realloc, ERANGE] Set `errno = 0` before to tell if the
+ operation failed due to error. @order \O(|`key`|); the trees visited are
+ amortized \O(1) when it's greater than all the keys. With `TRIE_SCORE`,
+ updating the maximum scores still goes down from the root. @allow */
+static int T_(trie_hint_add)(struct T_(trie) *const trie,
+	struct T_(trie_hint) *const hint, PT_(type) *const x) {
+	int is_added;
+	return assert(trie && hint && x),
+		TRIE_RECORD_OP(TRIE_RECORD_ADD, PT_(to_key)(x)),
+		PT_(hint_add)(trie, hint, x, &is_added)
+		&& TRIE_JOURNAL_IS(trie, is_added, TRIE_RECORD_ADD, x);
+}
+
+/** Updates or adds a pointer to `x` into `trie`.
+ @param[eject] If not null, on success it will hold the overwritten value or
+ a pointer-to-null if it did not overwrite any value.
+ @return Success. @throws[realloc, ERANGE] @order \O(|`key`|) @allow */
+static int T_(trie_put)(struct T_(trie) *const trie, PT_(type) *const x,
+	PT_(type) **const eject)
+	{ return assert(trie && x),
+	TRIE_RECORD_OP(TRIE_RECORD_PUT, PT_(to_key)(x)),
+	TRIE_JOURNAL_IS(trie, PT_(put)(trie, x, eject, 0), TRIE_RECORD_PUT, x); }
 
 /** Adds a pointer to `x` to `trie` only if the entry is absent or if calling
  `replace` returns true or is null.
@@ -806,37 +3062,479 @@ static int T_(trie_put)(struct T_(trie) *const trie, PT_(type) *const x,
  @return Success. @throws[realloc, ERANGE] @order \O(|`key`|) @allow */
 static int T_(trie_policy_put)(struct T_(trie) *const trie, PT_(type) *const x,
 	PT_(type) **const eject, const PT_(replace_fn) replace)
-	{ return assert(trie && x), PT_(put)(trie, x, eject, replace); }
+	{ return assert(trie && x),
+	TRIE_RECORD_OP(TRIE_RECORD_PUT, PT_(to_key)(x)),
+	TRIE_JOURNAL_IS(trie, PT_(put)(trie, x, eject, replace),
+	TRIE_RECORD_PUT, x); }
 
 /** Fills `it` with iteration parameters that find values of keys that start
  with `prefix` in `trie`.
  @param[prefix] To fill `it` with the entire `trie`, use the empty string.
  @param[it] A pointer to an iterator that gets filled. It is valid until a
  topological change to `trie`. Calling <fn:<T>trie_next> will iterate them in
- order. @order \O(|`prefix`|) */
+ order. @order \O(|`prefix`|) @allow */
 static void T_(trie_prefix)(const struct T_(trie) *const trie,
 	const char *const prefix, struct T_(trie_iterator) *const it)
-	{ PT_(prefix)(trie, prefix, it); }
+	{ TRIE_RECORD_OP(TRIE_RECORD_PREFIX, prefix),
+	PT_(prefix)(trie, prefix, it); }
+
+/** Fills `it` the same as <fn:<T>trie_prefix>, except the cursor is after
+ the last element; calling <fn:<T>trie_previous> will iterate them in reverse
+ order. @order \O(|`prefix`|) @allow */
+static void T_(trie_prefix_last)(const struct T_(trie) *const trie,
+	const char *const prefix, struct T_(trie_iterator) *const it)
+	{ PT_(prefix)(trie, prefix, it), it->leaf = it->leaf_end; }
 
-/** Counts the of the items in the new `it`; iterator must be new,
- (calling <fn:<T>trie_next> causes it to become undefined.)
- @order \O(|`it`|) @allow @fixme Allow `<T>trie_next`. */
+/** Counts the of the items in the range of `it`, independent of the
+ cursor. @order \O(|`it`|) @allow */
 static size_t T_(trie_size)(const struct T_(trie_iterator) *const it)
 	{ return PT_(size)(it); }
 
-/** Advances `it`. @return The previous value or null. @allow */
-static PT_(type) *T_(trie_next)(struct T_(trie_iterator) *const it) {
-	struct PT_(iterator) shunt;
+/** Advances `it`. @return The value after the cursor or null. @allow */
+static PT_(type) *T_(trie_next)(struct T_(trie_iterator) *const it)
+	{ return PT_(forward)(it); }
+
+/** Goes back in `it`; it mirrors <fn:<T>trie_next>, so calling one after the
+ other will give the same value twice.
+ @return The value before the cursor or null. @allow */
+static PT_(type) *T_(trie_previous)(struct T_(trie_iterator) *const it)
+	{ return PT_(backward)(it); }
+
+/** @return The value with the least key in `trie` or null if it's empty.
+ @order \O(`depth`) @allow */
+static PT_(type) *T_(trie_first)(const struct T_(trie) *const trie)
+	{ return assert(trie), trie->root ? PT_(leftmost)(trie->root, 0) : 0; }
+
+/** @return The value with the greatest key in `trie` or null if it's empty.
+ @order \O(`depth`) @allow */
+static PT_(type) *T_(trie_last)(const struct T_(trie) *const trie)
+	{ return assert(trie), trie->root ? PT_(rightmost)(trie->root) : 0; }
+
+/** Removes the value with the least key in `trie`, going down the left edge
+ once; this is useful as a priority queue.
+ @return The removed value or null if `trie` is empty.
+ @order \O(`depth`) @allow */
+static PT_(type) *T_(trie_pop_first)(struct T_(trie) *const trie)
+	{ return TRIE_JOURNAL_REMOVE(trie, PT_(remove)(trie, 0, 0)); }
+
+/** Removes the value with the greatest key in `trie`, going down the right
+ edge once. @return The removed value or null if `trie` is empty.
+ @order \O(`depth`) @allow */
+static PT_(type) *T_(trie_pop_last)(struct T_(trie) *const trie)
+	{ return TRIE_JOURNAL_REMOVE(trie, PT_(remove)(trie, 0, 1)); }
+
+/** Removes every value in `trie` whose key starts with `prefix`. Instead of
+ going down once per key, they are cut out of the index all at once, and the
+ trees that hold only them are freed whole.
+ @param[action] If not-null, is called on each removed value, in order.
+ @return Success.
+ @order \O(|`prefix`| + `TRIE_ORDER` + trees removed), plus the values
+ removed if `action` is called. @allow */
+static int T_(trie_remove_prefix)(struct T_(trie) *const trie,
+	const char *const prefix, const PT_(action_fn) action) {
+	/* The keys are gone after, so they are journalled before. */
+	TRIE_JOURNAL_PREFIX(trie, prefix, TRIE_RECORD_REMOVE);
+	return PT_(remove_prefix)(trie, prefix, action);
+}
+
+/** Fills `stats` with the shape of `trie`: the number of trees and keys,
+ histograms of tree fill, forest depth, and `skip`, (the last is escaped,)
+ and the memory used. It looks at every tree once, without recursion, so it's
+ suitable for exporting periodically from a large `trie`.
+ @return Success. @throws[realloc, ERANGE] @order \O(trees) @allow */
+static int T_(trie_stats)(const struct T_(trie) *const trie,
+	struct trie_stats *const stats) { return PT_(stats)(trie, stats); }
+
+/** Copies `trie` into `clone`. Instead of adding every value again, the
+ trees are copied whole, so it's about the speed of copying the memory.
+ @param[clone] Must start idle, and not be `trie`. On error, it's idle. It
+ has a copy of the filter, with `TRIE_BLOOM`, and no journal.
+ @param[copy] If null, `clone` has the same values as `trie`. Otherwise, for
+ a deep copy, each value is what `copy` returns for it, not in any order.
+ With `TRIE_SCORE`, the copies must score the same. If it returns null,
+ that's an error, and the copies made before are not given back; an arena is
+ a good fit.
+ @return Success. @throws[malloc, realloc, ERANGE]
+ @order \O(trees), plus the values if `copy` is called. @allow */
+static int T_(trie_clone)(struct T_(trie) *const clone,
+	const struct T_(trie) *const trie, const PT_(copy_fn) copy)
+	{ return PT_(clone)(clone, trie, copy); }
+
+/** Adds every value that is in `a` or `b` to `out`; if the key is in both,
+ the value from `a` is used.
+ @param[out] Must start idle, and not be `a` or `b`. On error, it holds the
+ values that were added so far.
+ @return Success. @throws[malloc, ERANGE]
+ @order \O(|`a`| + |`b`|) @allow */
+static int T_(trie_union)(struct T_(trie) *const out,
+	const struct T_(trie) *const a, const struct T_(trie) *const b)
+	{ return PT_(set)(out, a, b, TRIE_UNION); }
+
+/** Adds every value of `a` whose key is also in `b` to `out`. When one trie
+ is behind, it skips ahead by looking up the other's key, so sparse overlaps
+ skip whole sub-trees. @param[out] Must start idle, and not be `a` or `b`.
+ @return Success. @throws[malloc, ERANGE] @allow */
+static int T_(trie_intersect)(struct T_(trie) *const out,
+	const struct T_(trie) *const a, const struct T_(trie) *const b)
+	{ return PT_(set)(out, a, b, TRIE_INTERSECT); }
+
+/** Adds every value of `a` whose key is not in `b` to `out`. `b` skips ahead
+ like <fn:<T>trie_intersect>. @param[out] Must start idle, and not be `a` or
+ `b`. @return Success. @throws[malloc, ERANGE] @allow */
+static int T_(trie_difference)(struct T_(trie) *const out,
+	const struct T_(trie) *const a, const struct T_(trie) *const b)
+	{ return PT_(set)(out, a, b, TRIE_DIFFERENCE); }
+
+/** Moves every value in `trie` whose key is not less than `key` to `right`.
+ Only the trees on the path where they part are split; the rest move as they
+ are, so it's much faster than moving them one at a time.
+ @param[right] Must be idle and not `trie`.
+ @return Success. @throws[malloc] `trie` and `right` are unchanged on
+ error. @order \O(depth (|`key`| + `TRIE_ORDER`)) @allow */
+static int T_(trie_split)(struct T_(trie) *const trie, const char *const key,
+	struct T_(trie) *const right) {
+	return PT_(split)(trie, key, right) ? (TRIE_BLOOM_SPLIT(trie, right),
+		TRIE_CACHE_STALE(trie), 1) : 0;
+}
+
+/** Moves every value in `right` to `left`, which must all have keys less than
+ those in `right`, such as the output of <fn:<T>trie_split>. Only the trees on
+ the edges where they meet are replaced.
+ @return Success, and `right` is idle. @throws[malloc] @throws[EDOM] The keys
+ are not in order. `left` and `right` are unchanged on error.
+ @order \O(depth \cdot `TRIE_ORDER` + |`key`|) @allow */
+static int T_(trie_join)(struct T_(trie) *const left,
+	struct T_(trie) *const right)
+	{ return PT_(join)(left, right) ? (TRIE_BLOOM_JOIN(left, right),
+	TRIE_CACHE_JOIN(left, right), 1) : 0; }
+
+#ifdef TRIE_SCORE /* <!-- score */
+
+/* A leaf waiting in <fn:<T>trie_top_k> by the greatest score under it. */
+struct PT_(top) { double max; const struct PT_(tree) *tree; unsigned lf; };
+
+/** Adds `top` to the max-heap, `heap`, of `size`, which has room. */
+static void PT_(top_push)(struct PT_(top) *const heap, size_t size,
+	const struct PT_(top) top) {
+	size_t up;
+	for( ; size && heap[up = (size - 1) / 2].max < top.max; size = up)
+		heap[size] = heap[up];
+	heap[size] = top;
+}
+
+/** Removes the greatest of the non-empty max-heap, `heap`, of `*size`.
+ @return The greatest. */
+static struct PT_(top) PT_(top_pop)(struct PT_(top) *const heap,
+	size_t *const size) {
+	const struct PT_(top) top = heap[0], last = heap[--*size];
+	size_t i = 0, child;
+	while((child = 2 * i + 1) < *size) {
+		if(child + 1 < *size && heap[child].max < heap[child + 1].max) child++;
+		if(heap[child].max <= last.max) break;
+		heap[i] = heap[child], i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+/** Fills `out` with the `k` data of keys that start with `prefix` in `trie`
+ that have the greatest `TRIE_SCORE`, in descending order. It goes
+ best-first: the leaves wait on a heap by the greatest score under them, so
+ it only goes into the trees that have one better than what's already been
+ found. @param[out] Room for `k`.
+ @return How many are in `out`; less than `k` when there are not that many.
+ @throws[realloc, ERANGE] Stops; set `errno = 0` before to tell.
+ @order \O(|`prefix`| + `k` \cdot depth \cdot `TRIE_ORDER`) @allow */
+static size_t T_(trie_top_k)(const struct T_(trie) *const trie,
+	const char *const prefix, const size_t k, PT_(type) **const out) {
+	struct T_(trie_iterator) it;
+	struct PT_(top) *heap = 0, top;
+	const struct PT_(tree) *tree;
+	size_t size = 0, capacity = 0, n = 0;
+	unsigned lf, end;
+	assert(trie && prefix && (out || !k));
+	PT_(prefix)(trie, prefix, &it);
+	tree = it.end, lf = it.leaf_begin, end = it.leaf_end;
+	while(n < k) {
+		if(capacity - size < TRIE_ORDER) {
+			struct PT_(top) *const h = realloc(heap,
+				sizeof *heap * (capacity += capacity + TRIE_ORDER));
+			if(!h) { if(!errno) errno = ERANGE; break; }
+			heap = h;
+		}
+		for(top.tree = tree; lf < end; lf++) top.lf = lf,
+			top.max = PT_(leaf_max)(tree, lf), PT_(top_push)(heap, size++, top);
+		if(!size) break;
+		top = PT_(top_pop)(heap, &size);
+		if(trie_bmp_test(&top.tree->is_child, top.lf))
+			tree = top.tree->leaf[top.lf].child, lf = 0, end = tree->bsize + 1u;
+		else
+			out[n++] = top.tree->leaf[top.lf].data, lf = end = 0;
+	}
+	free(heap);
+	return n;
+}
+
+/** The score of the datum at `key` in `trie` has changed in place; finds the
+ greatest scores on it's path again. @order \O(depth \cdot `TRIE_ORDER`)
+ @allow */
+static void T_(trie_rescore)(struct T_(trie) *const trie,
+	const char *const key) { assert(trie && key); TRIE_SCORE_KEY(trie, key); }
+
+#endif /* score --> */
+
+#ifdef TRIE_METRICS /* <!-- metrics */
+/** Copies the counters of every trie of this type into `metrics`, if not
+ null, and zeros them. @order \Theta(1) @allow */
+static void T_(trie_metrics)(struct trie_metrics *const metrics) {
+	if(metrics) memcpy(metrics, &PT_(metrics), sizeof *metrics);
+	memset(&PT_(metrics), 0, sizeof PT_(metrics));
+}
+#endif /* metrics --> */
+
+#ifdef TRIE_RECORD /* <!-- record */
+/** Starts appending a log of operations on every trie of this type to `fp`,
+ or stops if it's null. The log is the input of `bench/replay.c`. Errors are
+ those of `fp`, and it is not synchronized. @order \Theta(1) @allow */
+static void T_(trie_record)(FILE *const fp) { PT_(record_fp) = fp; }
+#endif /* record --> */
+
+#ifdef TRIE_JOURNAL /* <!-- journal */
+static void PT_(journal_prefix)(const struct T_(trie) *const trie,
+	const char *const prefix, const enum trie_record_op op) {
+	struct T_(trie_iterator) it;
 	PT_(type) *x;
-	assert(it && (it->next && it->root || !it->next));
-	/* This adds another constraint: instead of ending when the trie has no
-	 more entries like <fn:<PT>next>, we check if it has passed the point. */
-	if(it->next == it->end && it->leaf >= it->leaf_end) return 0;
-	shunt.root = it->root, shunt.next = it->next,
-		shunt.leaf = it->leaf, x = PT_(next)(&shunt);
-	it->next = shunt.next, it->leaf = shunt.leaf;
-	return x;
+	PT_(prefix)(trie, prefix, &it);
+	while(x = PT_(forward)(&it))
+		trie_journal_append(trie->journal, op, PT_(to_key)(x));
+}
+
+/** Starts appending successful changes to `trie` to `journal`, or stops if
+ it's null. Splits, joins, and set operations are not journalled; take a
+ <fn:<T>trie_checkpoint> after. @order \Theta(1) @allow */
+static void T_(trie_journal)(struct T_(trie) *const trie,
+	struct trie_journal *const journal)
+	{ assert(trie); trie->journal = journal; }
+
+/** Appends every key of `trie`, in order, to `snapshot` and commits it. A
+ crash after this only has to replay the snapshot and the journal started
+ after it, so the journal can be truncated.
+ @return Success. @throws[fputc, fflush, sync] @order \O(|`trie`|) @allow */
+static int T_(trie_checkpoint)(const struct T_(trie) *const trie,
+	struct trie_journal *const snapshot) {
+	struct PT_(iterator) it;
+	PT_(type) *x;
+	assert(trie && snapshot);
+	PT_(begin)(&it, trie);
+	while(x = PT_(next)(&it))
+		trie_journal_append(snapshot, TRIE_RECORD_ADD, PT_(to_key)(x));
+	return trie_journal_commit(snapshot);
+}
+
+/** Applies a journal, or a checkpoint, in `log` of `size` bytes, to `trie`.
+ Instead of replaying every record, only the last change to each key counts;
+ the records are sorted by key, (checkpoints already are,) the removes are
+ done, and then the adds are like <fn:<T>trie_add_sorted_batch>. A record at
+ the end that was cut short by the crash is ignored. The keys point into
+ `log`, which must stay for the life of `trie`. It is not journalled.
+ @param[valid] If not null, on success, gets the bytes of `log` up to the end
+ of the last whole record. Before appending to the journal again, truncate it
+ to this, (`ftruncate`;) otherwise the next record is glued to the partial one.
+ @return Success. @throws[malloc, ERANGE] @throws[EDOM] `log` is not
+ a journal. @order \O(|`log`| \log |`log`|); \O(|`log`|) for a checkpoint
+ into an idle `trie`. @allow */
+static int T_(trie_journal_replay)(struct T_(trie) *const trie,
+	const char *const log, const size_t size, size_t *const valid) {
+	const char *a, *z, *const end = log + size, **record = 0;
+	size_t records = 0, i, j;
+	struct T_(trie_hint) hint;
+	int is_added, is_sorted = 1, success = 0;
+	assert(trie && (log || !size));
+	for(a = log; a < end && (z = memchr(a, '\0', (size_t)(end - a)));
+		a = z + 1, records++) if(*a != TRIE_RECORD_ADD
+		&& *a != TRIE_RECORD_PUT && *a != TRIE_RECORD_REMOVE)
+		return errno = EDOM, 0;
+	if(valid) *valid = (size_t)(a - log);
+	if(!records) return 1;
+	if(!(record = malloc(sizeof *record * records))) goto catch;
+	for(a = log, i = 0; i < records; a = strchr(a + 1, '\0') + 1, i++) {
+		record[i] = a;
+		if(i && strcmp(record[i - 1] + 1, a + 1) >= 0) is_sorted = 0;
+	}
+	if(!is_sorted) qsort(record, records, sizeof *record,
+		&trie_journal_compare);
+	/* The last of each key: removes first, so the hint stays valid. */
+	errno = 0;
+	for(i = 0; i < records; i = j + 1) {
+		for(j = i; j + 1 < records && !strcmp(record[j] + 1,
+			record[j + 1] + 1); j++);
+		if(*record[j] == TRIE_RECORD_REMOVE)
+			PT_(remove)(trie, record[j] + 1, 0);
+	}
+	if(errno) goto catch;
+	T_(trie_hint)(&hint);
+	for(i = 0; i < records; i = j + 1) {
+		for(j = i; j + 1 < records && !strcmp(record[j] + 1,
+			record[j + 1] + 1); j++);
+		if(*record[j] != TRIE_RECORD_REMOVE
+			&& !PT_(hint_add)(trie, &hint, record[j] + 1, &is_added))
+			goto catch;
+	}
+	success = 1;
+catch:
+	free(record);
+	return success;
 }
+#endif /* journal --> */
+
+#ifdef TRIE_DUMP /* <!-- dump */
+#ifdef TRIE_SET
+#define TRIE_DUMP_WIDTH 0 /* The keys are the values. */
+#else
+#define TRIE_DUMP_WIDTH sizeof(PT_(type))
+#endif
+
+/** Writes every key of `trie`, in order, to `fp` in blocks that are
+ front-coded, followed by their values, if it has them, and the index of the
+ blocks. The snapshot is usually a fraction of the size of the keys.
+ @return Success. @throws[realloc, fputc, fwrite] @order \O(|`trie`|) @allow */
+static int T_(trie_dump)(const struct T_(trie) *const trie, FILE *const fp) {
+	struct PT_(iterator) it;
+	PT_(type) *x, *block[TRIE_DUMP_BLOCK];
+	const char *key, *prev = "";
+	size_t *index = 0, index_size = 0, index_capacity = 0, count = 0,
+		bytes = 0, longest = 0, offset = TRIE_DUMP_HEADER, len, shared, i;
+	unsigned b = 0;
+	int success = 0;
+	assert(trie && fp);
+	fputs("trie", fp), fputc(TRIE_DUMP_VERSION, fp);
+	fputc(TRIE_DUMP_BLOCK, fp), fputc(0, fp), fputc(0, fp);
+	trie_dump_number(fp, TRIE_DUMP_WIDTH);
+	PT_(begin)(&it, trie);
+	for( ; ; ) {
+		x = PT_(next)(&it);
+		if(b == TRIE_DUMP_BLOCK || !x && b) { /* The values of the block. */
+			if(TRIE_DUMP_WIDTH) for(i = 0; i < b; i++)
+				fwrite(block[i], TRIE_DUMP_WIDTH, 1, fp);
+			offset += TRIE_DUMP_WIDTH * b, b = 0;
+		}
+		if(!x) break;
+		key = PT_(to_key)(x), len = strlen(key);
+		if(!b) { /* A whole key starts a block. */
+			if(index_size == index_capacity) {
+				size_t *const grow = realloc(index, sizeof *index
+					* (index_capacity = index_capacity ? 2 * index_capacity
+					: 64));
+				if(!grow) goto catch;
+				index = grow;
+			}
+			index[index_size++] = offset;
+			shared = 0;
+		} else {
+			for(shared = 0; prev[shared] == key[shared]; shared++);
+			offset += trie_dump_varint(fp, shared);
+		}
+		fwrite(key + shared, 1, len - shared + 1, fp);
+		offset += len - shared + 1;
+		block[b++] = x, prev = key, count++, bytes += len + 1;
+		if(len > longest) longest = len;
+	}
+	for(i = 0; i < index_size; i++) trie_dump_number(fp, index[i]);
+	trie_dump_number(fp, count), trie_dump_number(fp, bytes);
+	trie_dump_number(fp, longest), trie_dump_number(fp, offset);
+	if(!ferror(fp)) success = 1;
+catch:
+	free(index);
+	return success;
+}
+
+/** Adds every value of a `snapshot` of `size` bytes from <fn:<T>trie_dump>
+ to `trie`, which must be idle, in order, so it's building from the right
+ edge, like <fn:<T>trie_add_sorted_batch>.
+ @param[storage] Set to the memory for the keys or values that `trie` points
+ to; free it after `trie` is gone. Null on error.
+ @return Success. @throws[malloc, ERANGE] @throws[EDOM] `snapshot` is
+ not from this type, or is damaged; `trie` is idle.
+ @order \O(`size`) @allow */
+static int T_(trie_restore)(struct T_(trie) *const trie,
+	const char *const snapshot, const size_t size, void **const storage) {
+	const unsigned char *const s = (const unsigned char *)snapshot, *a, *z;
+	const size_t block_size = TRIE_DUMP_BLOCK;
+	size_t count, bytes, longest, index, blocks, k, i, len, shared, used = 0;
+	struct T_(trie_hint) hint;
+	char *keys = 0, *key, *prev = 0;
+	PT_(type) *x;
+	int is_added;
+	assert(trie && !trie->root && (snapshot || !size) && storage);
+	*storage = 0;
+	if(size < TRIE_DUMP_HEADER + TRIE_DUMP_TRAILER
+		|| memcmp(s, "trie", 4) || s[4] != TRIE_DUMP_VERSION
+		|| s[5] != TRIE_DUMP_BLOCK
+		|| trie_dump_read(s + 8) != TRIE_DUMP_WIDTH) goto damaged;
+	a = s + size - TRIE_DUMP_TRAILER;
+	count = trie_dump_read(a), bytes = trie_dump_read(a + 8);
+	longest = trie_dump_read(a + 16), index = trie_dump_read(a + 24);
+	blocks = count / block_size + !!(count % block_size);
+	if(index < TRIE_DUMP_HEADER || index > size - TRIE_DUMP_TRAILER
+		|| (size - TRIE_DUMP_TRAILER - index) / 8 != blocks
+		|| (size - TRIE_DUMP_TRAILER - index) % 8
+		/* Every key is at least a terminator; none is longer than all the
+		 suffixes; the bytes are at most the longest for each. */
+		|| count > (index - TRIE_DUMP_HEADER) / (TRIE_DUMP_WIDTH + 1)
+		|| longest >= index || bytes < count
+		|| count && bytes / count > longest + 1) goto damaged;
+	if(!count) return 1;
+	/* Sets keep the keys; others keep the values and decode the keys of a
+	 block in the space after. */
+	if(!(*storage = malloc(TRIE_DUMP_WIDTH ? TRIE_DUMP_WIDTH * count
+		+ block_size * (longest + 1) : bytes))) return 0;
+	keys = TRIE_DUMP_WIDTH ? (char *)*storage + TRIE_DUMP_WIDTH * count
+		: (char *)*storage;
+	T_(trie_hint)(&hint);
+	for(k = 0; k < blocks; k++) {
+		const size_t n = k + 1 < blocks ? block_size : count - k * block_size,
+			at = trie_dump_read(s + index + 8 * k);
+		if(at < TRIE_DUMP_HEADER || at >= index) goto damaged;
+		a = s + at;
+		for(i = 0; i < n; i++) {
+			shared = i ? trie_dump_unvarint(&a, s + index) : 0;
+			if(!(z = memchr(a, '\0', (size_t)(s + index - a)))) goto damaged;
+			len = shared + (size_t)(z - a);
+			key = TRIE_DUMP_WIDTH ? keys + i * (longest + 1) : keys + used;
+			if(len > longest || (used += len + 1) > bytes
+				|| i && shared > strlen(prev)) goto damaged;
+			if(shared) memcpy(key, prev, shared);
+			memcpy(key + shared, a, (size_t)(z - a) + 1), a = z + 1;
+			/* In order: the first difference is greater. */
+			if(prev && (i ? (unsigned char)key[shared]
+				<= (unsigned char)prev[shared] : strcmp(prev, key) >= 0))
+				goto damaged;
+			prev = key;
+			if(TRIE_DUMP_WIDTH) continue;
+			if(!PT_(hint_add)(trie, &hint, (PT_(type) *)(void *)key,
+				&is_added)) goto catch;
+		}
+		if(!TRIE_DUMP_WIDTH) continue;
+		if((size_t)(s + index - a) < TRIE_DUMP_WIDTH * n) goto damaged;
+		key = (char *)*storage + TRIE_DUMP_WIDTH * k * block_size;
+		memcpy(key, a, TRIE_DUMP_WIDTH * n);
+		x = (PT_(type) *)(void *)key;
+		for(i = 0; i < n; i++) {
+			if(strcmp(PT_(to_key)(x + i), keys + i * (longest + 1)))
+				goto damaged;
+			if(!PT_(hint_add)(trie, &hint, x + i, &is_added)) goto catch;
+		}
+		/* The next block is whole. */
+		prev = keys + (n - 1) * (longest + 1);
+	}
+	return 1;
+damaged:
+	errno = EDOM;
+catch:
+	T_(trie_)(trie), free(*storage), *storage = 0;
+	return 0;
+}
+#endif /* dump --> */
 
 /* <!-- box: Define these for traits. */
 #define BOX_ PT_
@@ -869,14 +3567,86 @@ static void PT_(unused_base_coda)(void);
 static void PT_(unused_base)(void) {
 	PT_(begin)(0, 0);
 	T_(trie)(0); T_(trie_)(0);
-	T_(trie_match)(0, 0); T_(trie_get)(0, 0);
+	T_(trie_match)(0, 0); T_(trie_get)(0, 0); T_(trie_longest_prefix)(0, 0);
+	T_(trie_fuzzy)(0, 0, 0, 0); T_(trie_glob)(0, 0, 0); T_(trie_glob_next)(0);
+	T_(trie_group_counts)(0, 0, 0, 0, 0);
+	T_(trie_merge)(0, 0, 0, 0, 0); T_(trie_merge_range)(0, 0, 0, 0, 0, 0);
+	T_(trie_merge_next)(0); T_(trie_merge_)(0);
 	T_(trie_remove)(0, 0);
 	T_(trie_add)(0, 0); T_(trie_put)(0, 0, 0); T_(trie_policy_put)(0, 0, 0, 0);
-	T_(trie_prefix)(0, 0, 0); T_(trie_size)(0); T_(trie_next)(0);
+	T_(trie_get_sorted_batch)(0, 0, 0, 0); T_(trie_add_sorted_batch)(0, 0, 0);
+	T_(trie_hint)(0); T_(trie_hint_add)(0, 0, 0);
+	T_(trie_prefix)(0, 0, 0); T_(trie_prefix_last)(0, 0, 0);
+	T_(trie_size)(0); T_(trie_next)(0); T_(trie_previous)(0);
+	T_(trie_first)(0); T_(trie_last)(0);
+	T_(trie_pop_first)(0); T_(trie_pop_last)(0);
+	T_(trie_remove_prefix)(0, 0, 0); T_(trie_stats)(0, 0);
+#ifdef TRIE_METRICS
+	T_(trie_metrics)(0);
+#endif
+#ifdef TRIE_RECORD
+	T_(trie_record)(0);
+#endif
+#ifdef TRIE_JOURNAL
+	trie_journal(0, 0, 0, 0); T_(trie_journal)(0, 0);
+	T_(trie_checkpoint)(0, 0); T_(trie_journal_replay)(0, 0, 0, 0);
+#endif
+#ifdef TRIE_DUMP
+	T_(trie_dump)(0, 0); T_(trie_restore)(0, 0, 0, 0);
+#endif
+#ifdef TRIE_SCORE
+	T_(trie_top_k)(0, 0, 0, 0); T_(trie_rescore)(0, 0);
+#endif
+	T_(trie_clone)(0, 0, 0);
+	T_(trie_union)(0, 0, 0); T_(trie_intersect)(0, 0, 0);
+	T_(trie_difference)(0, 0, 0); T_(trie_split)(0, 0, 0); T_(trie_join)(0, 0);
 	PT_(unused_base_coda)();
 }
 static void PT_(unused_base_coda)(void) { PT_(unused_base)(); }
 
+#undef TRIE_COUNT
+#ifdef TRIE_METRICS
+#undef TRIE_METRICS
+#endif
+#undef TRIE_RECORD_OP
+#undef TRIE_BLOOM_NO
+#undef TRIE_BLOOM_ADD
+#undef TRIE_BLOOM_REMOVE
+#undef TRIE_BLOOM_STALE
+#undef TRIE_BLOOM_SPLIT
+#undef TRIE_BLOOM_JOIN
+#undef TRIE_BLOOM_BYTES
+#ifdef TRIE_BLOOM
+#undef TRIE_BLOOM
+#endif
+#undef TRIE_CACHE_GET
+#undef TRIE_CACHE_ADD
+#undef TRIE_CACHE_STALE
+#undef TRIE_CACHE_JOIN
+#undef TRIE_CACHE_BYTES
+#undef TRIE_SCORE_TREE
+#undef TRIE_SCORE_CHANGE
+#undef TRIE_SCORE_KEY
+#undef TRIE_SCORE_EDGE
+#ifdef TRIE_SCORE
+#undef TRIE_SCORE
+#endif
+#ifdef TRIE_CACHE
+#undef TRIE_CACHE
+#endif
+#ifdef TRIE_RECORD
+#undef TRIE_RECORD
+#endif
+#ifdef TRIE_DUMP
+#undef TRIE_DUMP
+#endif
+#undef TRIE_DUMP_WIDTH
+#undef TRIE_JOURNAL_IS
+#undef TRIE_JOURNAL_REMOVE
+#undef TRIE_JOURNAL_PREFIX
+#ifdef TRIE_JOURNAL
+#undef TRIE_JOURNAL
+#endif
 #undef TRIE_NAME
 #undef TRIE_VALUE
 #undef TRIE_KEY
@@ -5,15 +5,22 @@
 #include <assert.h> /* assert */
 #include <errno.h>  /* errno */
 #include <time.h>   /* clock time */
+#include <string.h> /* strcpy strcat strlen strcmp */
 #include "orcish.h"
 
 /* A set of strings. `TRIE_TO_STRING` and `TRIE_TEST` are for graphing; one
  doesn't need them otherwise. */
 #define TRIE_NAME str
+#define TRIE_DUMP
 #define TRIE_TO_STRING
 #define TRIE_TEST &str_filler
 #include "../src/trie.h"
 
+/* A set of strings that has a journal for recovery. */
+#define TRIE_NAME jrnl
+#define TRIE_JOURNAL
+#include "../src/trie.h"
+
 /* You can have an `enum` in a `trie`, pointing to a fixed set of strings. */
 #define PARAM(A) A
 #define STRINGIZE(A) #A
@@ -81,6 +88,7 @@ static const char *star_key(const struct star *const star)
 #define TRIE_NAME star
 #define TRIE_VALUE struct star
 #define TRIE_KEY &star_key
+#define TRIE_BLOOM
 #define TRIE_TEST &star_filler
 #define TRIE_TO_STRING
 #include "../src/trie.h"
@@ -94,6 +102,8 @@ static const char *str4_key(const struct str4 *const s) { return s->value; }
 #define TRIE_NAME str4
 #define TRIE_VALUE struct str4
 #define TRIE_KEY &str4_key
+#define TRIE_RECORD
+#define TRIE_DUMP
 #define TRIE_TEST &str4_filler
 #define TRIE_TO_STRING
 #include "../src/trie.h"
@@ -105,9 +115,14 @@ static void keyval_filler(struct keyval *const kv)
 	orcish(kv->key, sizeof kv->key); }
 static const char *keyval_key(const struct keyval *const kv)
 	{ return kv->key; }
+static double keyval_score(const struct keyval *const kv)
+	{ return kv->value; }
 #define TRIE_NAME keyval
 #define TRIE_VALUE struct keyval
 #define TRIE_KEY &keyval_key
+#define TRIE_SCORE &keyval_score
+#define TRIE_METRICS
+#define TRIE_CACHE 64
 #define TRIE_TEST &keyval_filler
 #define TRIE_TO_STRING
 #include "../src/trie.h"
@@ -159,10 +174,414 @@ static void contrived_str_test(void) {
 	str_trie_(&strs);
 }
 
+/** A prefix that goes down to one key that's shorter than it doesn't match. */
+static void short_key_prefix_test(void) {
+	struct str_trie strs = TRIE_IDLE;
+	struct str_trie_iterator it;
+	const char *const keys[] = { "ba", "c", "foo" };
+	const struct { const char *prefix; size_t size; } query[] = {
+		{ "bab", 0 }, { "foob", 0 }, { "cc", 0 }, { "b", 1 }, { "ba", 1 },
+		{ "fo", 1 }, { "", 3 } };
+	size_t i, n;
+	printf("Short key prefix test.\n");
+	for(i = 0; i < sizeof keys / sizeof *keys; i++)
+		if(!str_trie_add(&strs, keys[i])) assert(0);
+	for(i = 0; i < sizeof query / sizeof *query; i++) {
+		str_trie_prefix(&strs, query[i].prefix, &it);
+		assert(str_trie_size(&it) == query[i].size);
+		for(n = 0; str_trie_next(&it); n++);
+		assert(n == query[i].size);
+	}
+	str_trie_(&strs);
+}
+
+/** Routing table, where the longest stored prefix of a path is it's route.
+ <fn:<T>trie_longest_prefix> is checked against repeatedly truncating the path
+ and calling <fn:<T>trie_get>; bench/route.c times them. */
+static void routing_test(void) {
+	struct str_trie routes = TRIE_IDLE;
+	static char route_store[512][128], path_store[4096][192];
+	const size_t route_size = sizeof route_store / sizeof *route_store,
+		path_size = sizeof path_store / sizeof *path_store;
+	size_t i, j, routes_in = 0, found = 0;
+	printf("Routing table test.\n");
+	/* Routes are hierarchical; each one extends an earlier one. */
+	strcpy(route_store[0], "/");
+	for(i = 1; i < route_size; i++) {
+		const char *const up
+			= route_store[(unsigned)rand() / (RAND_MAX / i + 1)];
+		char name[12];
+		orcish(name, sizeof name);
+		if(strlen(up) + strlen(name) + 2 > sizeof *route_store)
+			{ strcpy(route_store[i], up); continue; }
+		strcpy(route_store[i], up), strcat(route_store[i], name),
+			strcat(route_store[i], "/");
+	}
+	errno = 0;
+	for(i = 0; i < route_size; i++)
+		if(str_trie_add(&routes, route_store[i])) routes_in++;
+	assert(!errno);
+	for(i = 0; i < path_size; i++) {
+		/* Some of them have no route. */
+		const char *const r = i & 7 ? route_store[(unsigned)rand()
+			/ (RAND_MAX / route_size + 1)] : "";
+		char name[12];
+		orcish(name, sizeof name);
+		sprintf(path_store[i], "%s%s", r, name);
+	}
+	for(i = 0; i < path_size; i++) {
+		char truncate[sizeof *path_store];
+		const char *get;
+		strcpy(truncate, path_store[i]);
+		for(j = strlen(truncate); ; j--) {
+			truncate[j] = '\0';
+			if((get = str_trie_get(&routes, truncate)) || !j) break;
+		}
+		if(get) found++;
+		assert(get == str_trie_longest_prefix(&routes, path_store[i]));
+	}
+	printf("%lu routes, %lu paths, %lu have one.\n", (unsigned long)routes_in,
+		(unsigned long)path_size, (unsigned long)found);
+	str_trie_(&routes);
+	/* The path differs in a bit that the branch of "ab" skips. */
+	assert(str_trie_add(&routes, "ab") && str_trie_add(&routes, "ab\x41"));
+	assert(!strcmp(str_trie_longest_prefix(&routes, "ab\xc1"), "ab"));
+	str_trie_(&routes);
+}
+
+/* A binary heap of timestamps to compare with `queue_test`. */
+static void heap_push(const char **const heap, size_t *const size,
+	const char *const x) {
+	size_t i = (*size)++;
+	while(i && strcmp(heap[(i - 1) / 2], x) > 0)
+		heap[i] = heap[(i - 1) / 2], i = (i - 1) / 2;
+	heap[i] = x;
+}
+static const char *heap_pop(const char **const heap, size_t *const size) {
+	const char *const top = heap[0], *const x = heap[--*size];
+	size_t i = 0, c;
+	while((c = 2 * i + 1) < *size) {
+		if(c + 1 < *size && strcmp(heap[c + 1], heap[c]) < 0) c++;
+		if(strcmp(x, heap[c]) <= 0) break;
+		heap[i] = heap[c], i = c;
+	}
+	heap[i] = x;
+	return top;
+}
+
+/** Using the trie as a priority queue keyed by zero-padded timestamps with
+ <fn:<T>trie_pop_first>, compared with a binary heap. */
+static void queue_test(void) {
+	struct str_trie queue = TRIE_IDLE;
+	static char time_store[20000][12];
+	static const char *heap[sizeof time_store / sizeof *time_store];
+	const size_t time_size = sizeof time_store / sizeof *time_store;
+	size_t i, size = 0, heap_size = 0;
+	const char *x, *y;
+	clock_t t[2];
+	printf("Priority queue test.\n");
+	for(i = 0; i < time_size; i++)
+		sprintf(time_store[i], "%05lu%05lu", /* Ten digits in any `long`. */
+		(unsigned long)rand() % 100000ul, (unsigned long)rand() % 100000ul);
+	/* Trie. */
+	t[0] = clock();
+	errno = 0;
+	for(i = 0; i < time_size; i++)
+		if(str_trie_add(&queue, time_store[i])) size++;
+	assert(!errno);
+	for(x = 0, i = 0; y = str_trie_pop_first(&queue); x = y, i++)
+		assert(!x || strcmp(x, y) < 0);
+	assert(i == size && !queue.root);
+	t[0] = clock() - t[0];
+	/* Heap; has duplicates, but that's fine. */
+	t[1] = clock();
+	for(i = 0; i < time_size; i++) heap_push(heap, &heap_size, time_store[i]);
+	for(x = 0; heap_size; x = y)
+		y = heap_pop(heap, &heap_size), assert(!x || strcmp(x, y) <= 0);
+	t[1] = clock() - t[1];
+	printf("%lu timestamps, %lu unique: trie add and pop_first %f s;"
+		" binary heap push and pop %f s.\n", (unsigned long)time_size,
+		(unsigned long)size, (double)t[0] / CLOCKS_PER_SEC,
+		(double)t[1] / CLOCKS_PER_SEC);
+	/* From the other end. */
+	for(i = 0; i < time_size; i++) str_trie_add(&queue, time_store[i]);
+	for(x = 0, i = 0; y = str_trie_pop_last(&queue); x = y, i++)
+		assert(!x || strcmp(x, y) > 0);
+	assert(i == size && !queue.root);
+	str_trie_(&queue);
+}
+
+/** Paths that share much more than a `skip` can hold: the same long directory
+ is repeated a random number of times before the name. */
+static void long_prefix_test(void) {
+	struct str_trie paths = TRIE_IDLE, right = TRIE_IDLE;
+	static char path_store[2000][320];
+	const size_t path_size = sizeof path_store / sizeof *path_store;
+	const char *const dir = "/srv/www/example.com/public_html/assets/";
+	struct str_trie_iterator it;
+	struct trie_stats stats;
+	size_t i, j, size = 0;
+	const char *x, *y;
+	printf("Long prefix test.\n");
+	for(i = 0; i < path_size; i++) {
+		char name[12];
+		const size_t repeat = (unsigned)rand() / (RAND_MAX / 6 + 1) + 1;
+		for(path_store[i][0] = '\0', j = 0; j < repeat; j++)
+			strcat(path_store[i], dir);
+		orcish(name, sizeof name);
+		strcat(path_store[i], name);
+	}
+	errno = 0;
+	for(i = 0; i < path_size; i++)
+		if(str_trie_add(&paths, path_store[i])) size++;
+	assert(!errno);
+	for(i = 0; i < path_size; i++)
+		assert(!strcmp(str_trie_get(&paths, path_store[i]), path_store[i]));
+	str_trie_stats(&paths, &stats);
+	printf("%lu paths, %lu unique, %lu escaped skips.\n",
+		(unsigned long)path_size, (unsigned long)size,
+		(unsigned long)stats.skip[UCHAR_MAX]);
+	assert(stats.keys == size && stats.skip[UCHAR_MAX]);
+	/* Splitting and joining where the prefix repeats. */
+	if(!str_trie_split(&paths, path_store[0], &right)
+		|| !str_trie_join(&paths, &right)) assert(0);
+	str_trie_prefix(&paths, dir, &it);
+	for(x = 0, i = 0; y = str_trie_next(&it); x = y, i++)
+		assert(!x || strcmp(x, y) < 0);
+	assert(i == size);
+	for(i = 0; i < path_size; i++) if(str_trie_remove(&paths, path_store[i]))
+		size--;
+	assert(!size && !paths.root);
+	str_trie_(&paths);
+}
+
+/** Set operations on a trie whose root is one leaf pointing to a child, which
+ is what's left after removing the right side of a split root. */
+static void set_root_test(void) {
+	struct str_trie a = TRIE_IDLE, b = TRIE_IDLE, c = TRIE_IDLE;
+	struct str_trie_iterator it;
+	static char number[257][5];
+	const char *x;
+	size_t i;
+	int ret;
+	printf("Set root test.\n");
+	for(i = 0; i < sizeof number / sizeof *number; i++) {
+		sprintf(number[i], "%04lu", (unsigned long)(i * 7 % 4000));
+		if(!str_trie_add(&a, number[i])) assert(0);
+	}
+	assert(a.root && a.root->bsize);
+	while(a.root->bsize) if(!str_trie_pop_last(&a)) assert(0);
+	assert(trie_bmp_test(&a.root->is_child, 0));
+	if(!str_trie_add(&b, "0105") || !str_trie_add(&b, "0106")) assert(0);
+	ret = str_trie_intersect(&c, &a, &b), assert(ret);
+	str_trie_prefix(&c, "", &it), x = str_trie_next(&it);
+	assert(x && !strcmp(x, "0105") && !str_trie_next(&it));
+	str_trie_(&c);
+	ret = str_trie_intersect(&c, &b, &a), assert(ret);
+	str_trie_prefix(&c, "", &it), assert(str_trie_size(&it) == 1);
+	str_trie_(&c);
+	ret = str_trie_difference(&c, &b, &a), assert(ret);
+	str_trie_prefix(&c, "", &it), x = str_trie_next(&it);
+	assert(x && !strcmp(x, "0106") && !str_trie_next(&it));
+	str_trie_(&c), str_trie_(&b), str_trie_(&a);
+}
+
+/** Snapshots of a set, where the keys are all there is. */
+static void set_dump_test(void) {
+	struct str_trie strs = TRIE_IDLE;
+	static char word[1000][12];
+	size_t i;
+	printf("Set dump test.\n");
+	trie_str_valid_dump(&strs);
+	for(i = 0; i < sizeof word / sizeof *word; i++)
+		orcish(word[i], sizeof *word), str_trie_add(&strs, word[i]);
+	trie_str_valid_dump(&strs);
+	str_trie_(&strs);
+}
+
+/** Globs on log paths by day. */
+static void glob_test(void) {
+	struct str_trie logs = TRIE_IDLE;
+	struct str_trie_glob glob;
+	static char log_store[31 * 3][32];
+	const char *const level[] = { "error", "info", "warn" };
+	const struct { const char *pattern; size_t size; } query[] = {
+		{ "logs/2026-\?\?-1*/error", 10 }, { "logs/2026-01-1?/*", 30 },
+		{ "logs/2026-01-[12]?/warn", 20 }, { "logs/2026-01-[!0-2]?/*", 6 },
+		{ "*/i*", 31 }, { "logs/2026-01-31/info", 1 }, { "logs/2026-01-3", 0 },
+		{ "logs/2026-01-3*", 6 }, { "*", 93 }, { "", 0 }, { "l\\ogs*", 93 },
+		{ "[l]ogs/*/[]e]rror", 31 }, { "*?", 93 }, { "logs/?", 0 } };
+	const char *x, *y;
+	size_t i, j;
+	printf("Glob test.\n");
+	for(i = 0; i < 31; i++) for(j = 0; j < 3; j++) {
+		sprintf(log_store[i * 3 + j], "logs/2026-01-%02lu/%s",
+			(unsigned long)i + 1, level[j]);
+		if(!str_trie_add(&logs, log_store[i * 3 + j])) assert(0);
+	}
+	for(i = 0; i < sizeof query / sizeof *query; i++) {
+		str_trie_glob(&logs, query[i].pattern, &glob);
+		for(x = 0, j = 0; y = str_trie_glob_next(&glob); x = y, j++)
+			assert((!x || strcmp(x, y) < 0) && trie_glob_match(query[i].pattern,
+			y));
+		printf("\"%s\": %lu.\n", query[i].pattern, (unsigned long)j);
+		assert(j == query[i].size && !str_trie_glob_next(&glob));
+	}
+	str_trie_(&logs);
+}
+
+/** Merges windows of numbers where some are in more than one. */
+static void merge_test(void) {
+	struct str_trie window[4];
+	struct str_trie_merge merge;
+	static char number[4][300][4];
+	const enum trie_merge_policy policy[]
+		= { TRIE_MERGE_FIRST, TRIE_MERGE_LAST, TRIE_MERGE_ALL };
+	const struct { const char *prefix, *from, *to; } query[] = {
+		{ "", 0, 0 }, { "1", 0, 0 }, { "29", 0, 0 }, { "3", 0, 0 },
+		{ "0001", 0, 0 }, { 0, 0, 0 }, { 0, "050", "150" }, { 0, "2", 0 },
+		{ 0, 0, "007" }, { 0, "150", "050" } };
+	const char *x, *y;
+	size_t i, j, w, p, count, want;
+	int ret;
+	printf("Merge test.\n");
+	for(w = 0; w < 4; w++) {
+		str_trie(window + w);
+		for(i = 0; i < 300; i++) if(!(i % (w + 2))) {
+			sprintf(number[w][i], "%03lu", (unsigned long)i);
+			if(!str_trie_add(window + w, number[w][i])) assert(0);
+		}
+	}
+	for(i = 0; i < sizeof query / sizeof *query; i++)
+		for(p = 0; p < sizeof policy / sizeof *policy; p++) {
+		errno = 0;
+		ret = query[i].prefix
+			? str_trie_merge(&merge, window, 4, query[i].prefix, policy[p])
+			: str_trie_merge_range(&merge, window, 4, query[i].from,
+			query[i].to, policy[p]);
+		assert(ret);
+		for(x = 0, count = 0; y = str_trie_merge_next(&merge); x = y, count++) {
+			const size_t n = (size_t)atoi(y);
+			/* Which window it came from. */
+			for(w = 0; y != number[w][n]; w++) assert(w < 3);
+			assert(!x || strcmp(x, y) < (policy[p] == TRIE_MERGE_ALL));
+			if(policy[p] == TRIE_MERGE_FIRST)
+				for(j = 0; j < w; j++) assert(n % (j + 2));
+			else if(policy[p] == TRIE_MERGE_LAST)
+				for(j = w + 1; j < 4; j++) assert(n % (j + 2));
+			else if(x && !strcmp(x, y))
+				assert(x != number[w][n] && (size_t)(x - number[0][0])
+				< (size_t)(y - number[0][0]));
+		}
+		str_trie_merge_(&merge);
+		for(want = 0, j = 0; j < 300; j++) {
+			char a[4];
+			sprintf(a, "%03lu", (unsigned long)j);
+			if(query[i].prefix ? strncmp(a, query[i].prefix,
+				strlen(query[i].prefix)) : query[i].from
+				&& strcmp(a, query[i].from) < 0
+				|| query[i].to && strcmp(a, query[i].to) >= 0) continue;
+			if(policy[p] == TRIE_MERGE_ALL) {
+				for(w = 0; w < 4; w++) if(!(j % (w + 2))) want++;
+			} else if(!(j % 2) || !(j % 3) || !(j % 5)) want++;
+		}
+		assert(count == want);
+	}
+	for(w = 0; w < 4; w++) str_trie_(window + w);
+}
+
+/** Reads all of `fp` from the start into `*buffer` of `*size`. */
+static void slurp(FILE *const fp, char **const buffer, size_t *const size) {
+	long end;
+	fseek(fp, 0, SEEK_END), end = ftell(fp), rewind(fp);
+	assert(end >= 0);
+	*buffer = malloc((size_t)end + 1), assert(*buffer);
+	*size = fread(*buffer, 1, (size_t)end, fp);
+	assert(*size == (size_t)end);
+}
+
+/** Whether `a` and `b` have the same keys. */
+static int jrnl_is_equal(const struct jrnl_trie *const a,
+	const struct jrnl_trie *const b) {
+	struct jrnl_trie_iterator i, j;
+	const char *x, *y;
+	jrnl_trie_prefix(a, "", &i), jrnl_trie_prefix(b, "", &j);
+	do {
+		x = jrnl_trie_next(&i), y = jrnl_trie_next(&j);
+		if(!x || !y) return !x && !y;
+	} while(!strcmp(x, y));
+	return 0;
+}
+
+/** Changes a trie with a journal, checkpoints it, changes it more, and then
+ recovers it from the checkpoint and the journal after, and from both
+ journals. */
+static void journal_test(void) {
+	struct jrnl_trie trie = TRIE_IDLE, snapshot = TRIE_IDLE,
+		history = TRIE_IDLE;
+	struct trie_journal journal[2], checkpoint;
+	FILE *fp[3] = { 0, 0, 0 };
+	static char key_store[2000][12];
+	const size_t key_size = sizeof key_store / sizeof *key_store;
+	char *buffer[3] = { 0, 0, 0 };
+	size_t size[3], i, valid;
+	printf("Journal test.\n");
+	for(i = 0; i < 3; i++) fp[i] = tmpfile(), assert(fp[i]);
+	for(i = 0; i < key_size; i++) orcish(key_store[i], sizeof *key_store);
+	trie_journal(journal + 0, fp[0], 16, 0);
+	trie_journal(journal + 1, fp[1], 16, 0);
+	trie_journal(&checkpoint, fp[2], 64, 0);
+	errno = 0;
+	jrnl_trie_journal(&trie, journal + 0);
+	for(i = 0; i < key_size / 2; i++) jrnl_trie_add(&trie, key_store[i]);
+	for(i = 0; i < key_size / 2; i += 3) jrnl_trie_remove(&trie, key_store[i]);
+	assert(trie_journal_commit(journal + 0));
+	assert(jrnl_trie_checkpoint(&trie, &checkpoint));
+	jrnl_trie_journal(&trie, journal + 1);
+	for(i = key_size / 2; i < key_size; i++) {
+		if(i & 1) jrnl_trie_put(&trie, key_store[i], 0);
+		else jrnl_trie_add(&trie, key_store[i]);
+	}
+	for(i = 0; i < key_size; i += 5) jrnl_trie_remove(&trie, key_store[i]);
+	jrnl_trie_pop_first(&trie), jrnl_trie_pop_last(&trie);
+	jrnl_trie_remove_prefix(&trie, "B", 0);
+	for(i = 0; i < key_size; i += 7) jrnl_trie_add(&trie, key_store[i]);
+	assert(trie_journal_commit(journal + 1) && !errno);
+	jrnl_trie_journal(&trie, 0);
+	for(i = 0; i < 3; i++) slurp(fp[i], buffer + i, size + i);
+	/* Checkpoint and the tail. */
+	assert(jrnl_trie_journal_replay(&snapshot, buffer[2], size[2], 0)
+		&& jrnl_trie_journal_replay(&snapshot, buffer[1], size[1], &valid)
+		&& valid == size[1]);
+	assert(jrnl_is_equal(&trie, &snapshot));
+	/* Both journals; a record that's cut short is ignored, but not valid. */
+	assert(jrnl_trie_journal_replay(&history, buffer[0], size[0], 0)
+		&& jrnl_trie_journal_replay(&history, buffer[1], size[1], 0)
+		&& jrnl_trie_journal_replay(&history, "a", 1, &valid) && !valid);
+	assert(jrnl_is_equal(&trie, &history));
+	assert(!jrnl_trie_journal_replay(&history, "?\0", 2, 0)
+		&& errno == EDOM);
+	errno = 0;
+	printf("Journal %lu bytes, checkpoint %lu bytes, and tail %lu bytes.\n",
+		(unsigned long)size[0], (unsigned long)size[2],
+		(unsigned long)size[1]);
+	jrnl_trie_(&trie), jrnl_trie_(&snapshot), jrnl_trie_(&history);
+	for(i = 0; i < 3; i++) fclose(fp[i]), free(buffer[i]);
+}
+
 int main(void) {
 	unsigned seed = (unsigned)clock();
 	srand(seed), rand(), printf("Seed %u.\n", seed);
 	contrived_str_test();
+	short_key_prefix_test();
+	routing_test();
+	queue_test();
+	long_prefix_test();
+	set_root_test();
+	set_dump_test();
+	glob_test();
+	merge_test();
+	journal_test();
 	colour_trie_test();
 	star_trie_test();
 	str4_trie_test();
@@ -8,15 +8,13 @@
 #define QUOTE_(name) #name
 #define QUOTE(name) QUOTE_(name)
 
-/** Works by side-effects, _ie_ fills the type with data. Only defined if
- `TRIE_TEST`. */
-typedef void (*PT_(action_fn))(PT_(type) *);
 /* Used in <fn:<PT>graph_choose>. */
 typedef void (*PT_(tree_file_fn))(const struct PT_(tree) *, size_t, FILE *);
 
 #ifndef TRIE_SET /* <!-- !set: Don't bother trying to test it automatically. */
 
-/* `TRIE_TEST` must be a function that implements <typedef:<PT>action_fn>. */
+/* `TRIE_TEST` must be a function that implements <typedef:<PT>action_fn>; it
+ works by side-effects, _ie_ fills the type with data. */
 static void (*PT_(filler))(PT_(type) *) = (TRIE_TEST);
 
 #endif /* set --> */
@@ -83,9 +81,10 @@ static void PT_(graph_tree_bits)(const struct PT_(tree) *const tree,
 	for(i = 0; i <= tree->bsize; i++) {
 		const char *key = PT_(sample)(tree, i);
 		const struct trie_branch *branch = tree->branch;
-		size_t next_branch = treebit + branch->skip;
+		size_t next_branch
+			= tree->bsize ? PT_(decision)(tree, 0, 0, treebit) : 0;
 		const char *params, *start, *end;
-		struct { unsigned br0, br1; } in_tree;
+		struct { unsigned br0, br1, lf; } in_tree;
 		unsigned is_child = trie_bmp_test(&tree->is_child, i);
 		/* 0-width joiner "&#8288;": GraphViz gets upset when tag closed
 		 immediately. */
@@ -94,7 +93,7 @@ static void PT_(graph_tree_bits)(const struct PT_(tree) *const tree,
 			" PORT=\"%u\">%s%s%s⊔</FONT></TD>\n",
 			i, is_child ? "↓<FONT COLOR=\"Gray85\">" : "", key,
 			is_child ? "" : "<FONT COLOR=\"Gray85\">");
-		in_tree.br0 = 0, in_tree.br1 = tree->bsize;
+		in_tree.br0 = 0, in_tree.br1 = tree->bsize, in_tree.lf = 0;
 		for(b = 0; in_tree.br0 < in_tree.br1; b++) {
 			const unsigned bit = !!TRIE_QUERY(key, b);
 			if(next_branch) {
@@ -107,11 +106,14 @@ static void PT_(graph_tree_bits)(const struct PT_(tree) *const tree,
 					start = "", end = "";
 				} else {
 					in_tree.br0 += branch->left + 1;
+					in_tree.lf += branch->left + 1;
 					params
 						= " BGCOLOR=\"Black\" COLOR=\"White\" BORDER=\"1\"";
 					start = "<FONT COLOR=\"White\">", end = "</FONT>";
 				}
-				next_branch = (branch = tree->branch + in_tree.br0)->skip;
+				branch = tree->branch + in_tree.br0;
+				next_branch = in_tree.br0 < in_tree.br1 ? PT_(decision)(tree,
+					in_tree.br0, in_tree.lf, b + 1) - (b + 1) : 0;
 			}
 			if(b && !(b & 7)) fprintf(fp, "\t\t<TD BORDER=\"0\">&nbsp;</TD>\n");
 			fprintf(fp, "\t\t<TD%s>%s%u%s</TD>\n", params, start, bit, end);
@@ -131,7 +133,7 @@ static void PT_(graph_tree_bits)(const struct PT_(tree) *const tree,
 		in_tree.br0 = 0, in_tree.br1 = tree->bsize, in_tree.lf = 0;
 		while(in_tree.br0 < in_tree.br1) {
 			const struct trie_branch *branch = tree->branch + in_tree.br0;
-			bit += branch->skip;
+			bit = PT_(decision)(tree, in_tree.br0, in_tree.lf, bit);
 			if(i <= in_tree.lf + branch->left)
 				in_tree.br1 = ++in_tree.br0 + branch->left;
 			else
@@ -198,7 +200,7 @@ static void PT_(graph_tree_mem)(const struct PT_(tree) *const tree,
 		in_tree.br0 = 0, in_tree.br1 = tree->bsize, in_tree.lf = 0;
 		while(in_tree.br0 < in_tree.br1) {
 			branch = tree->branch + in_tree.br0;
-			bit += branch->skip;
+			bit = PT_(decision)(tree, in_tree.br0, in_tree.lf, bit);
 			if(i <= in_tree.lf + branch->left)
 				in_tree.br1 = ++in_tree.br0 + branch->left;
 			else
@@ -354,6 +356,82 @@ static void PT_(print)(const struct PT_(tree) *const tree) {
 
 #endif
 
+#ifdef TRIE_DUMP /* <!-- dump */
+#ifndef TRIE_SET
+static void PT_(valid)(const struct T_(trie) *);
+#endif
+
+/** Restores `size` of `buffer`, which is damaged. */
+static void PT_(damaged_dump)(const char *const buffer, const size_t size) {
+	struct T_(trie) copy = TRIE_IDLE;
+	void *storage;
+	int ret;
+	errno = 0;
+	ret = T_(trie_restore)(&copy, buffer, size, &storage);
+	assert(!ret && errno == EDOM && !storage && !copy.root);
+	errno = 0;
+}
+
+/** A snapshot of `trie` restores the same, and a damaged one doesn't: one
+ that's cut short, one with a bad trailer, and one where the key in the
+ middle of the first block shares more than the one before it has. */
+static void PT_(valid_dump)(const struct T_(trie) *const trie) {
+	struct T_(trie) copy = TRIE_IDLE;
+	struct T_(trie_iterator) it, it2;
+	FILE *const fp = tmpfile();
+	char *buffer;
+	long size;
+	size_t count = 0, key_bytes = 0, i;
+	void *storage;
+	PT_(type) *x, *y;
+	int ret;
+	assert(fp);
+	ret = T_(trie_dump)(trie, fp), assert(ret);
+	size = ftell(fp), assert(size > 0), rewind(fp);
+	buffer = malloc((size_t)size), assert(buffer);
+	ret = fread(buffer, 1, (size_t)size, fp) == (size_t)size, assert(ret);
+	fclose(fp);
+	ret = T_(trie_restore)(&copy, buffer, (size_t)size, &storage);
+	assert(ret);
+#ifndef TRIE_SET
+	PT_(valid)(&copy);
+#endif
+	T_(trie_prefix)(trie, "", &it), T_(trie_prefix)(&copy, "", &it2);
+	while(x = T_(trie_next)(&it)) {
+		y = T_(trie_next)(&it2), assert(y && y != x);
+		assert(!strcmp(PT_(to_key)(x), PT_(to_key)(y)));
+		assert(!TRIE_DUMP_WIDTH || !memcmp(x, y, TRIE_DUMP_WIDTH));
+		key_bytes += strlen(PT_(to_key)(x)) + 1, count++;
+	}
+	assert(!T_(trie_next)(&it2) && (storage || !count));
+	T_(trie_)(&copy), free(storage);
+	printf("Snapshot of %lu bytes of keys and %lu of values: %lu bytes.\n",
+		(unsigned long)key_bytes, (unsigned long)(count * TRIE_DUMP_WIDTH),
+		(unsigned long)size);
+	PT_(damaged_dump)(buffer, (size_t)size - 1);
+	PT_(damaged_dump)(buffer, (size_t)size / 2);
+	PT_(damaged_dump)(buffer, TRIE_DUMP_HEADER);
+	if(count >= 2) {
+		const size_t middle
+			= (count < TRIE_DUMP_BLOCK ? count : TRIE_DUMP_BLOCK) / 2;
+		unsigned char *a = (unsigned char *)buffer + TRIE_DUMP_HEADER, *v;
+		unsigned char was;
+		/* Past the whole key and the ones after, to the varint of `middle`. */
+		a += strlen((char *)a) + 1;
+		for(i = 1; i < middle; i++) {
+			trie_dump_unvarint((const unsigned char **)&a,
+				(unsigned char *)buffer + size);
+			a += strlen((char *)a) + 1;
+		}
+		v = a, was = *v, assert(!(was & 128) && trie_dump_read(
+			(unsigned char *)buffer + size - TRIE_DUMP_TRAILER + 16) < 127);
+		*v = 127, PT_(damaged_dump)(buffer, (size_t)size), *v = was;
+	}
+	buffer[size - 1] ^= 1, PT_(damaged_dump)(buffer, (size_t)size);
+	free(buffer);
+}
+#endif /* dump --> */
+
 #ifndef TRIE_SET /* <!-- !set: a set of strings is not testable in the
  automatic framework, but convenient to have graphs for manual tests. */
 
@@ -364,7 +442,7 @@ static void PT_(valid_tree)(const struct PT_(tree) *const tree) {
 	const char *str1 = 0;
 	assert(tree && tree->bsize <= TRIE_BRANCHES);
 	for(i = 0; i < tree->bsize; i++)
-		assert(tree->branch[i].left < tree->bsize - 1 - i);
+		assert(tree->branch[i].left <= tree->bsize - 1 - i);
 	for(i = 0; i <= tree->bsize; i++) {
 		if(trie_bmp_test(&tree->is_child, i)) {
 			PT_(valid_tree)(tree->leaf[i].child);
@@ -376,6 +454,9 @@ static void PT_(valid_tree)(const struct PT_(tree) *const tree) {
 			str1 = str2;
 		}
 	}
+#ifdef TRIE_SCORE
+	assert(tree->max == PT_(tree_max)(tree));
+#endif
 }
 
 /** Makes sure the `trie` is in a valid state. */
@@ -384,6 +465,289 @@ static void PT_(valid)(const struct T_(trie) *const trie) {
 	PT_(valid_tree)(trie->root);
 }
 
+/** Iterates through `prefix` in `trie` forwards and backwards, making sure
+ they are in order and agree with each other and the size. */
+static void PT_(valid_range)(const struct T_(trie) *const trie,
+	const char *const prefix) {
+	struct T_(trie_iterator) it;
+	PT_(type) *x, *y, *forward[1000];
+	size_t size, n = 0, m;
+	const char *key = 0, *prev_key;
+	T_(trie_prefix)(trie, prefix, &it);
+	size = T_(trie_size)(&it);
+	while(x = T_(trie_next)(&it)) {
+		prev_key = key, key = PT_(to_key)(x);
+		assert(trie_is_prefix(prefix, key) && strlen(prefix) <= strlen(key));
+		assert(!prev_key || strcmp(prev_key, key) < 0);
+		if(n < sizeof forward / sizeof *forward) forward[n] = x;
+		n++;
+	}
+	assert(n == size && T_(trie_size)(&it) == size);
+	/* It's a cursor, so going back gives the same one. */
+	m = n;
+	while(x = T_(trie_previous)(&it)) {
+		assert(m && (--m >= sizeof forward / sizeof *forward
+			|| forward[m] == x));
+		if(!(y = T_(trie_next)(&it))) assert(0); else assert(x == y);
+		x = T_(trie_previous)(&it), assert(x == y);
+	}
+	assert(!m);
+	/* Same thing in reverse. */
+	T_(trie_prefix_last)(trie, prefix, &it);
+	m = n;
+	while(x = T_(trie_previous)(&it)) assert(m && (--m
+		>= sizeof forward / sizeof *forward || forward[m] == x));
+	assert(!m && (!n || x == 0 && T_(trie_next)(&it) == forward[0]));
+}
+
+/** Makes sure the set operations on `a` and a trie that overlaps it agree
+ with <fn:<T>trie_get>. */
+static void PT_(valid_set)(const struct T_(trie) *const a) {
+	struct T_(trie) b = TRIE_IDLE, c = TRIE_IDLE;
+	struct T_(trie_iterator) it;
+	static PT_(type) extra[300];
+	PT_(type) *x;
+	size_t i, size_a, size_b, both = 0;
+	int ret;
+	/* `b` has every third of `a` and some others. */
+	T_(trie_prefix)(a, "", &it), size_a = T_(trie_size)(&it);
+	for(i = 0; x = T_(trie_next)(&it); i++)
+		if(!(i % 3)) ret = T_(trie_add)(&b, x), assert(ret);
+	for(i = 0; i < sizeof extra / sizeof *extra; i++)
+		PT_(filler)(extra + i), T_(trie_add)(&b, extra + i);
+	T_(trie_prefix)(&b, "", &it), size_b = T_(trie_size)(&it);
+	while(x = T_(trie_next)(&it))
+		if(T_(trie_get)(a, PT_(to_key)(x))) both++;
+	ret = T_(trie_union)(&c, a, &b), assert(ret);
+	T_(trie_prefix)(&c, "", &it);
+	assert(T_(trie_size)(&it) == size_a + size_b - both);
+	while(x = T_(trie_next)(&it)) {
+		PT_(type) *const y = T_(trie_get)(a, PT_(to_key)(x));
+		assert(y ? y == x : T_(trie_get)(&b, PT_(to_key)(x)) == x);
+	}
+	T_(trie_)(&c);
+	ret = T_(trie_intersect)(&c, a, &b), assert(ret);
+	T_(trie_prefix)(&c, "", &it), assert(T_(trie_size)(&it) == both);
+	while(x = T_(trie_next)(&it)) assert(T_(trie_get)(a, PT_(to_key)(x)) == x
+		&& T_(trie_get)(&b, PT_(to_key)(x)));
+	T_(trie_)(&c);
+	ret = T_(trie_difference)(&c, a, &b), assert(ret);
+	T_(trie_prefix)(&c, "", &it), assert(T_(trie_size)(&it) == size_a - both);
+	while(x = T_(trie_next)(&it)) assert(T_(trie_get)(a, PT_(to_key)(x)) == x
+		&& !T_(trie_get)(&b, PT_(to_key)(x)));
+	T_(trie_)(&c);
+	printf("Set operations: %lu and %lu with %lu in common.\n",
+		(unsigned long)size_a, (unsigned long)size_b, (unsigned long)both);
+	T_(trie_)(&b);
+	assert(!errno);
+}
+
+/** Splits `trie` at `key`, makes sure both sides are in order and agree with
+ <fn:<T>trie_get>, and joins them back. */
+static void PT_(valid_split)(struct T_(trie) *const trie,
+	const char *const key) {
+	struct T_(trie) right = TRIE_IDLE;
+	struct T_(trie_iterator) it;
+	PT_(type) *x;
+	size_t size, size_l, size_r;
+	int ret;
+	T_(trie_prefix)(trie, "", &it), size = T_(trie_size)(&it);
+	ret = T_(trie_split)(trie, key, &right), assert(ret);
+	PT_(valid)(trie), PT_(valid)(&right);
+	T_(trie_prefix)(trie, "", &it), size_l = T_(trie_size)(&it);
+	while(x = T_(trie_next)(&it)) assert(strcmp(PT_(to_key)(x), key) < 0
+		&& T_(trie_get)(trie, PT_(to_key)(x)) == x);
+	T_(trie_prefix)(&right, "", &it), size_r = T_(trie_size)(&it);
+	while(x = T_(trie_next)(&it)) assert(strcmp(PT_(to_key)(x), key) >= 0
+		&& T_(trie_get)(&right, PT_(to_key)(x)) == x);
+	assert(size_l + size_r == size);
+	if(size_l && size_r) {
+		x = T_(trie_first)(&right);
+		ret = T_(trie_join)(&right, trie), assert(!ret && errno == EDOM);
+		assert(T_(trie_first)(&right) == x), errno = 0;
+	}
+	ret = T_(trie_join)(trie, &right), assert(ret && !right.root);
+	PT_(valid)(trie);
+	T_(trie_prefix)(trie, "", &it), assert(T_(trie_size)(&it) == size);
+	while(x = T_(trie_next)(&it))
+		assert(T_(trie_get)(trie, PT_(to_key)(x)) == x);
+}
+
+/* Counts <fn:<PT>count_removed>. */
+static size_t PT_(removed);
+
+/** Counts `x`. */
+static void PT_(count_removed)(PT_(type) *const x)
+	{ assert(x), PT_(removed)++; }
+
+/** Removes `prefix` from `trie` and makes sure that they, and only they,
+ are gone. */
+static void PT_(valid_remove_prefix)(struct T_(trie) *const trie,
+	const char *const prefix) {
+	struct T_(trie_iterator) it;
+	PT_(type) *x;
+	size_t size, size_p;
+	int ret;
+	T_(trie_prefix)(trie, "", &it), size = T_(trie_size)(&it);
+	T_(trie_prefix)(trie, prefix, &it), size_p = T_(trie_size)(&it);
+	PT_(removed) = 0;
+	ret = T_(trie_remove_prefix)(trie, prefix, &PT_(count_removed));
+	assert(ret && PT_(removed) == size_p);
+	PT_(valid)(trie);
+	T_(trie_prefix)(trie, prefix, &it), assert(!T_(trie_size)(&it));
+	T_(trie_prefix)(trie, "", &it), assert(T_(trie_size)(&it) == size - size_p);
+	while(x = T_(trie_next)(&it))
+		assert(strncmp(prefix, PT_(to_key)(x), strlen(prefix))
+		&& T_(trie_get)(trie, PT_(to_key)(x)) == x);
+}
+
+/** @return The Levenshtein distance of `a` and `b`, the slow way. */
+static unsigned PT_(edits)(const char *const a, const char *const b) {
+	const size_t size = strlen(b);
+	unsigned *const row = malloc(sizeof *row * (size + 1)), diag, up, e;
+	size_t i, j;
+	assert(row);
+	for(j = 0; j <= size; j++) row[j] = (unsigned)j;
+	for(i = 0; a[i] != '\0'; i++) for(diag = row[0], row[0] = (unsigned)i + 1,
+		j = 1; j <= size; diag = up, j++) {
+		up = row[j], e = diag + (a[i] != b[j - 1]);
+		if(up + 1 < e) e = up + 1;
+		if(row[j - 1] + 1 < e) e = row[j - 1] + 1;
+		row[j] = e;
+	}
+	e = row[size], free(row);
+	return e;
+}
+
+/* The query of <fn:<PT>count_fuzzy>, the last key it found, and how many. */
+static const char *PT_(fuzzy_key), *PT_(fuzzy_last);
+static size_t PT_(fuzzies);
+
+/** Checks that `x` is `edits` from the query and in order. */
+static void PT_(count_fuzzy)(PT_(type) *const x, const unsigned edits) {
+	const char *const key = PT_(to_key)(x);
+	assert(PT_(edits)(PT_(fuzzy_key), key) == edits);
+	assert(!PT_(fuzzy_last) || strcmp(PT_(fuzzy_last), key) < 0);
+	PT_(fuzzy_last) = key, PT_(fuzzies)++;
+}
+
+/** Looks for keys near `key` in `trie` within `max` edits, and compares
+ them to going through all of them. */
+static void PT_(valid_fuzzy)(const struct T_(trie) *const trie,
+	const char *const key, const unsigned max) {
+	struct T_(trie_iterator) it;
+	PT_(type) *x;
+	size_t size = 0;
+	int ret;
+	PT_(fuzzy_key) = key, PT_(fuzzy_last) = 0, PT_(fuzzies) = 0;
+	ret = T_(trie_fuzzy)(trie, key, max, &PT_(count_fuzzy)), assert(ret);
+	T_(trie_prefix)(trie, "", &it);
+	while(x = T_(trie_next)(&it))
+		if(PT_(edits)(key, PT_(to_key)(x)) <= max) size++;
+	assert(PT_(fuzzies) == size);
+}
+
+/** Goes through the matches of `pattern` in `trie`, and compares them to
+ going through all of them. */
+static void PT_(valid_glob)(const struct T_(trie) *const trie,
+	const char *const pattern) {
+	struct T_(trie_iterator) it;
+	struct T_(trie_glob) glob;
+	PT_(type) *x, *y = 0;
+	size_t size = 0;
+	T_(trie_glob)(trie, pattern, &glob);
+	while(x = T_(trie_glob_next)(&glob)) {
+		assert(trie_glob_match(pattern, PT_(to_key)(x)));
+		assert(!y || strcmp(PT_(to_key)(y), PT_(to_key)(x)) < 0);
+		y = x, size++;
+	}
+	T_(trie_prefix)(trie, "", &it);
+	while(x = T_(trie_next)(&it))
+		if(trie_glob_match(pattern, PT_(to_key)(x))) size--;
+	assert(!size);
+}
+
+/* The query of <fn:<PT>count_group>, the last group, and how many values. */
+static const char *PT_(group_prefix), *PT_(group_last);
+static size_t PT_(group_depth), PT_(group_last_length), PT_(grouped);
+static char PT_(group_delim);
+
+/** @return The length of the group of `key`, the slow way. */
+static size_t PT_(group_length)(const char *const key) {
+	size_t i = strlen(PT_(group_prefix));
+	for( ; key[i] != '\0' && i < PT_(group_depth); i++)
+		if(PT_(group_delim) && key[i] == PT_(group_delim)) return i + 1;
+	return i;
+}
+
+/** Checks that `group` is all of the values with the first `length` of `key`
+ and is in order. */
+static void PT_(count_group)(const char *const key, const size_t length,
+	const size_t count, struct T_(trie_iterator) *const group) {
+	PT_(type) *x;
+	size_t size = 0;
+	assert(PT_(group_length)(key) == length);
+	assert(!PT_(group_last) || strncmp(PT_(group_last), key,
+		PT_(group_last_length) > length ? PT_(group_last_length) : length) < 0);
+	while(x = T_(trie_next)(group)) {
+		const char *const k = PT_(to_key)(x);
+		assert(PT_(group_length)(k) == length && !strncmp(k, key, length));
+		size++;
+	}
+	assert(size == count && count);
+	PT_(group_last) = key, PT_(group_last_length) = length;
+	PT_(grouped) += count;
+}
+
+/** Groups the keys of `trie` that start with `prefix` by `depth` and `delim`,
+ and compares them to going through all of them. */
+static void PT_(valid_group)(const struct T_(trie) *const trie,
+	const char *const prefix, const size_t depth, const char delim) {
+	struct T_(trie_iterator) it;
+	PT_(type) *x;
+	size_t size = 0;
+	PT_(group_prefix) = prefix, PT_(group_depth) = depth;
+	PT_(group_delim) = delim, PT_(group_last) = 0, PT_(grouped) = 0;
+	T_(trie_group_counts)(trie, prefix, depth, delim, &PT_(count_group));
+	T_(trie_prefix)(trie, "", &it);
+	while(x = T_(trie_next)(&it))
+		if(!strncmp(prefix, PT_(to_key)(x), strlen(prefix))) size++;
+	assert(PT_(grouped) == size);
+}
+
+/* How many times <fn:<PT>copy> is called, and after which it fails. */
+static size_t PT_(copies), PT_(copies_max);
+
+/** Counts `x`. @return `x`, or null when there are too many. */
+static PT_(type) *PT_(copy)(PT_(type) *const x)
+	{ return ++PT_(copies) > PT_(copies_max)
+	? (errno = EDOM, (PT_(type) *)0) : x; }
+
+/** Clones `trie` and compares them, and clones it again with a copy that
+ fails. */
+static void PT_(valid_clone)(const struct T_(trie) *const trie) {
+	struct T_(trie) clone = TRIE_IDLE;
+	struct T_(trie_iterator) i, j;
+	PT_(type) *x;
+	size_t size;
+	int ret;
+	PT_(copies) = 0, PT_(copies_max) = (size_t)-1;
+	ret = T_(trie_clone)(&clone, trie, &PT_(copy)), assert(ret);
+	PT_(valid)(&clone);
+	T_(trie_prefix)(trie, "", &i), T_(trie_prefix)(&clone, "", &j);
+	size = T_(trie_size)(&i), assert(PT_(copies) == size);
+	while(x = T_(trie_next)(&i)) assert(x == T_(trie_next)(&j)
+		&& T_(trie_get)(&clone, PT_(to_key)(x)) == x);
+	assert(!T_(trie_next)(&j));
+	assert(!trie->root || clone.root != trie->root);
+	T_(trie_)(&clone);
+	if(!size) return;
+	PT_(copies) = 0, PT_(copies_max) = size / 2, errno = 0;
+	ret = T_(trie_clone)(&clone, trie, &PT_(copy));
+	assert(!ret && errno == EDOM && !clone.root), errno = 0;
+	T_(trie_)(&clone);
+}
+
 /** Ignores `a` and `b`. @return False. */
 static int PT_(false)(PT_(type) *const a, PT_(type) *const b)
 	{ (void)a, (void)b; return 0; }
@@ -447,6 +811,13 @@ static void PT_(test)(void) {
 		}
 	}
 
+	/* Every key is it's own longest prefix. */
+	for(n = 0; n < es_size; n++) {
+		if(!es[n].is_in) continue;
+		data = T_(trie_longest_prefix)(&trie, PT_(to_key)(&es[n].data));
+		assert(data == &es[n].data);
+	}
+
 	/* Test prefix and size. */
 	{
 		size_t sum = !!T_(trie_get)(&trie, "");
@@ -462,6 +833,209 @@ static void PT_(test)(void) {
 			sum), assert(n == count && n == sum);
 	}
 
+	/* The shape adds up. */
+	{
+		struct trie_stats stats;
+		size_t i, trees = 0, depths = 0, skips = 0, branches = 0;
+		ret = T_(trie_stats)(&trie, &stats), assert(ret);
+		for(i = 0; i < TRIE_ORDER; i++)
+			trees += stats.bsize[i], branches += i * stats.bsize[i];
+		for(i = 0; i < TRIE_STATS_DEPTH; i++) depths += stats.depth[i];
+		for(i = 0; i <= UCHAR_MAX; i++) skips += stats.skip[i];
+		printf("Trie %lu trees of height %lu, %lu bytes, %.1f per key.\n",
+			(unsigned long)stats.trees, (unsigned long)stats.height,
+			(unsigned long)stats.bytes, stats.bytes_per_key);
+		assert(stats.keys == count && stats.trees == trees
+			&& stats.trees == depths && skips == branches
+			&& stats.keys == branches + 1 && stats.depth[0] == 1);
+	}
+
+	{ /* Batches in order are the same as one at a time. */
+		struct T_(trie) copy = TRIE_IDLE;
+		struct T_(trie_hint) hint;
+		PT_(type) *sorted[sizeof es / sizeof *es],
+			*got[sizeof es / sizeof *es];
+		const char *keys[sizeof es / sizeof *es];
+		size_t i, odd = 0, size = 0;
+		T_(trie_prefix)(&trie, "", &it);
+		while(data = T_(trie_next)(&it))
+			keys[size] = PT_(to_key)(data), sorted[size++] = data;
+		assert(size == count);
+		i = T_(trie_get_sorted_batch)(&trie, keys, size, got);
+		assert(i == size);
+		for(i = 0; i < size; i++) assert(got[i] == sorted[i]);
+		for(i = 1; i < size; i += 2) got[odd++] = sorted[i];
+		i = T_(trie_add_sorted_batch)(&copy, got, odd), assert(i == odd);
+		i = T_(trie_add_sorted_batch)(&copy, sorted, size);
+		assert(i == size - odd);
+		PT_(valid)(&copy);
+		i = T_(trie_get_sorted_batch)(&copy, keys, size, got);
+		assert(i == size);
+		for(i = 0; i < size; i++) assert(got[i] == sorted[i]);
+		T_(trie_)(&copy);
+		/* One at a time with a hint, backwards and then forwards. */
+		T_(trie_hint)(&hint);
+		for(i = size; i; i--)
+			ret = T_(trie_hint_add)(&copy, &hint, sorted[i - 1]), assert(ret);
+		for(i = 0; i < size; i++)
+			ret = T_(trie_hint_add)(&copy, &hint, sorted[i]), assert(!ret);
+		PT_(valid)(&copy);
+		i = T_(trie_get_sorted_batch)(&copy, keys, size, got);
+		assert(i == size);
+		for(i = 0; i < size; i++) assert(got[i] == sorted[i]);
+		T_(trie_)(&copy);
+	}
+
+#ifdef TRIE_BLOOM /* <!-- bloom */
+	{ /* No false negatives; few false positives on keys with a suffix. */
+		size_t i, present = 0, absent = 0, positives = 0;
+		char a[256];
+		assert(trie.bloom && trie.bloom->size == count);
+		for(i = 0; i < es_size; i++) {
+			const char *const key = PT_(to_key)(&es[i].data);
+			const size_t len = strlen(key);
+			if(!es[i].is_in || len + 2 > sizeof a) continue;
+			assert(trie_bloom_bits(trie.bloom, key, 1)), present++;
+			memcpy(a, key, len), a[len] = '~', a[len + 1] = '\0';
+			if(T_(trie_get)(&trie, a)) continue;
+			absent++;
+			if(trie_bloom_bits(trie.bloom, a, 1)) positives++;
+		}
+		printf("Bloom filter: %lu blocks, %lu present, %lu/%lu false"
+			" positives.\n", (unsigned long)trie.bloom->blocks,
+			(unsigned long)present, (unsigned long)positives,
+			(unsigned long)absent);
+		assert(positives * 10 <= absent);
+	}
+#endif /* bloom --> */
+
+#ifdef TRIE_RECORD /* <!-- record */
+	{ /* Each call is one record. */
+		FILE *const fp = tmpfile();
+		int c;
+		assert(fp);
+		T_(trie_record)(fp);
+		data = T_(trie_get)(&trie, "");
+		T_(trie_prefix)(&trie, "", &it);
+		T_(trie_record)(0);
+		rewind(fp);
+		c = fgetc(fp), assert(c == TRIE_RECORD_GET);
+		c = fgetc(fp), assert(c == '\0');
+		c = fgetc(fp), assert(c == TRIE_RECORD_PREFIX);
+		c = fgetc(fp), assert(c == '\0');
+		c = fgetc(fp), assert(c == EOF);
+		fclose(fp);
+	}
+#endif /* record --> */
+
+#ifdef TRIE_DUMP /* <!-- dump */
+	PT_(valid_dump)(&trie);
+#endif /* dump --> */
+
+#ifdef TRIE_SCORE /* <!-- score */
+	/* The best are the same as going through all of them, and the next after
+	 removing the best. */
+	for(m = 0; m < es_size; m += 97) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[2] = { '\0', '\0' };
+		PT_(type) *best[10];
+		size_t got, i, better = 0, tied = 0;
+		a[0] = key[0];
+		got = T_(trie_top_k)(&trie, a, sizeof best / sizeof *best, best);
+		T_(trie_prefix)(&trie, a, &it);
+		assert(got == (T_(trie_size)(&it) < 10 ? T_(trie_size)(&it) : 10));
+		if(!got) continue;
+		for(i = 1; i < got; i++)
+			assert(PT_(score)(best[i - 1]) >= PT_(score)(best[i]));
+		while(data = T_(trie_next)(&it))
+			if(PT_(score)(data) > PT_(score)(best[got - 1])) better++;
+			else if(PT_(score)(data) == PT_(score)(best[got - 1])) tied++;
+		for(i = 0; i < got
+			&& PT_(score)(best[i]) > PT_(score)(best[got - 1]); i++);
+		assert(i == better && better + tied >= got);
+		data = T_(trie_remove)(&trie, PT_(to_key)(best[0]));
+		assert(data == best[0]), PT_(valid)(&trie);
+		i = T_(trie_top_k)(&trie, a, 1, best), assert(i == (got > 1));
+		assert(!i || best[0] != data
+			&& PT_(score)(best[0]) <= PT_(score)(data));
+		ret = T_(trie_add)(&trie, data), assert(ret);
+	}
+#endif /* score --> */
+
+	/* Near keys, including ones that are not in. */
+	for(m = 0; m < es_size; m += 197) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[8];
+		size_t len = strlen(key);
+		PT_(valid_fuzzy)(&trie, key, 0);
+		assert(!es[m].is_in || PT_(fuzzies) == 1);
+		PT_(valid_fuzzy)(&trie, key, 2);
+		if(len >= sizeof a) len = sizeof a - 1;
+		memcpy(a, key, len), a[len] = '\0';
+		if(len) a[len / 2] = '~';
+		PT_(valid_fuzzy)(&trie, a, 1);
+	}
+	PT_(valid_fuzzy)(&trie, "", 3);
+
+	/* Globs from keys. */
+	for(m = 0; m < es_size; m += 197) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[16];
+		size_t len = strlen(key);
+		if(len > sizeof a - 3) len = sizeof a - 3;
+		memcpy(a, key, len), a[len] = '\0';
+		if(len > 1) a[1] = '?';
+		PT_(valid_glob)(&trie, a);
+		if(len > 2) a[2] = '*', a[3] = '\0', PT_(valid_glob)(&trie, a);
+		a[0] = '*', PT_(valid_glob)(&trie, a);
+	}
+	PT_(valid_glob)(&trie, "*");
+	PT_(valid_glob)(&trie, "[A-M]*");
+	PT_(valid_glob)(&trie, "[!a-z]?*");
+
+	/* Cloning. */
+	PT_(valid_clone)(&trie);
+
+	/* Groups of keys. */
+	PT_(valid_group)(&trie, "", 0, '\0');
+	PT_(valid_group)(&trie, "", 2, '\0');
+	PT_(valid_group)(&trie, "", (size_t)-1, 'a');
+	for(m = 0; m < es_size; m += 197) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[3] = { '\0', '\0', '\0' };
+		if(!(a[0] = key[0])) continue;
+		PT_(valid_group)(&trie, a, 3, 'r');
+		a[1] = key[1], PT_(valid_group)(&trie, a, 1, '\0');
+		PT_(valid_group)(&trie, a, 6, 'e');
+	}
+
+	/* Iterating both ways. */
+	PT_(valid_range)(&trie, "");
+	for(m = 0; m < es_size; m += 7) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[3] = { '\0', '\0', '\0' };
+		if(!(a[0] = key[0])) continue;
+		PT_(valid_range)(&trie, a);
+		a[1] = key[1], PT_(valid_range)(&trie, a);
+	}
+	T_(trie_prefix_last)(&trie, "", &it);
+	data = T_(trie_previous)(&it), assert(data && data == T_(trie_last)(&trie));
+
+	/* Union, intersection, and difference. */
+	PT_(valid_set)(&trie);
+
+	/* Split and join at keys that are in and not in. */
+	for(m = 0; m < es_size; m += 97) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[3] = { '\0', '\0', '\0' };
+		PT_(valid_split)(&trie, key);
+		if(!(a[0] = key[0])) continue;
+		PT_(valid_split)(&trie, a);
+		a[1] = key[1], PT_(valid_split)(&trie, a);
+	}
+	PT_(valid_split)(&trie, "");
+	T_(trie_prefix)(&trie, "", &it), assert(T_(trie_size)(&it) == count);
+
 	/* Replacement. */
 	ret = T_(trie_add)(&trie, &es[0].data); /* Doesn't add. */
 	assert(!ret);
@@ -488,6 +1062,39 @@ static void PT_(test)(void) {
 	ret = T_(trie_put)(&trie, &es[0].data, 0); /* Add. */
 	assert(ret && data == &es[0].data), es[0].is_in = 1;
 
+	/* Pop both ends and put them back. */
+	{
+		PT_(type) *const first = T_(trie_first)(&trie),
+			*const last = T_(trie_last)(&trie);
+		T_(trie_prefix)(&trie, "", &it);
+		assert(first && T_(trie_next)(&it) == first && last);
+		data = T_(trie_pop_first)(&trie);
+		assert(data == first && !T_(trie_get)(&trie, PT_(to_key)(first)));
+		data = T_(trie_pop_last)(&trie);
+		assert(data == last && !T_(trie_get)(&trie, PT_(to_key)(last)));
+		T_(trie_prefix)(&trie, "", &it), assert(T_(trie_size)(&it) == n - 2);
+		ret = T_(trie_add)(&trie, first), assert(ret);
+		ret = T_(trie_add)(&trie, last), assert(ret);
+		assert(T_(trie_first)(&trie) == first && T_(trie_last)(&trie) == last);
+	}
+
+	/* Remove prefixes and put them back. */
+	for(m = 0; m < es_size; m += 97) {
+		const char *const key = PT_(to_key)(&es[m].data);
+		char a[3] = { '\0', '\0', '\0' };
+		if(!(a[0] = key[0])) continue;
+		a[1] = key[1];
+		PT_(valid_remove_prefix)(&trie, a);
+		for(n = 0; n < es_size; n++) if(es[n].is_in
+			&& !strncmp(a, PT_(to_key)(&es[n].data), strlen(a)))
+			ret = T_(trie_add)(&trie, &es[n].data), assert(ret);
+		PT_(valid)(&trie);
+	}
+	PT_(valid_remove_prefix)(&trie, ""), assert(!trie.root);
+	for(n = 0; n < es_size; n++) if(es[n].is_in)
+		ret = T_(trie_add)(&trie, &es[n].data), assert(ret);
+	T_(trie_prefix)(&trie, "", &it), assert(T_(trie_size)(&it) == count);
+
 	for(n = 0; n < es_size; n++) {
 		const char *key;
 		if(!es[n].is_in) { /*printf("es %lu is not in\n", n);*/ continue; }
@@ -507,6 +1114,29 @@ static void PT_(test)(void) {
 
 	T_(trie_)(&trie), assert(!trie.root), PT_(valid)(&trie);
 	assert(!errno);
+#ifdef TRIE_METRICS /* <!-- metrics */
+	{
+		struct trie_metrics metrics;
+		T_(trie_metrics)(&metrics);
+		printf("Metrics: %lu matches visiting %lu trees; %lu adds taking %lu"
+			" samples, %lu splits, %lu restarts; %lu collapses; %lu frees.\n",
+			(unsigned long)metrics.matches, (unsigned long)metrics.match_trees,
+			(unsigned long)metrics.adds, (unsigned long)metrics.samples,
+			(unsigned long)metrics.splits, (unsigned long)metrics.restarts,
+			(unsigned long)metrics.collapses, (unsigned long)metrics.frees);
+		assert(metrics.matches && metrics.match_trees >= metrics.matches
+			&& metrics.adds && metrics.samples >= metrics.adds
+			&& metrics.splits && metrics.frees);
+#ifdef TRIE_CACHE
+		printf("Cache: %lu hits, %lu misses, %.0f%%.\n",
+			(unsigned long)metrics.cache_hits,
+			(unsigned long)metrics.cache_misses, 100.0 * metrics.cache_hits
+			/ (metrics.cache_hits + metrics.cache_misses + 1));
+		assert(metrics.cache_hits && metrics.cache_misses);
+#endif
+		T_(trie_metrics)(&metrics), assert(!metrics.adds);
+	}
+#endif /* metrics --> */
 }
 
 /** Will be tested on stdout. Requires `TRIE_TEST`, and not `NDEBUG` while